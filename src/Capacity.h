@@ -0,0 +1,58 @@
+#ifndef CAPACITY_H
+#define CAPACITY_H
+
+#include <utility>
+
+// Capacity classes for the generators.  Each class fixes the array sizes of
+// one instantiation (MaxN positions, MaxD chosen elements) so that small
+// problems keep tight, cache-resident state while large ones still fit.
+//
+//   MaxN:   64  128  256  1024  4096
+//   MaxD:   16   24   32    64   128
+//
+// A generator exposes its work as `template <int MaxN, int MaxD> struct Job`
+// with a static `run(...)`; DispatchCapacity() runs the smallest class that
+// holds n positions and d elements and returns false if none does.
+// Generators whose arrays depend on the positions alone expose
+// `template <int MaxN> struct Job` and use DispatchPositions() instead.
+
+template <template <int, int> class Job, class... Args>
+bool DispatchCapacity(int n, int d, Args &&...args) {
+    if (n <= 64 && d <= 16) {
+        Job<64, 16>::run(std::forward<Args>(args)...);
+    } else if (n <= 128 && d <= 24) {
+        Job<128, 24>::run(std::forward<Args>(args)...);
+    } else if (n <= 256 && d <= 32) {
+        Job<256, 32>::run(std::forward<Args>(args)...);
+    } else if (n <= 1024 && d <= 64) {
+        Job<1024, 64>::run(std::forward<Args>(args)...);
+    } else if (n <= 4096 && d <= 128) {
+        Job<4096, 128>::run(std::forward<Args>(args)...);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+template <template <int> class Job, class... Args>
+bool DispatchPositions(int n, Args &&...args) {
+    if (n <= 64) {
+        Job<64>::run(std::forward<Args>(args)...);
+    } else if (n <= 128) {
+        Job<128>::run(std::forward<Args>(args)...);
+    } else if (n <= 256) {
+        Job<256>::run(std::forward<Args>(args)...);
+    } else if (n <= 1024) {
+        Job<1024>::run(std::forward<Args>(args)...);
+    } else if (n <= 4096) {
+        Job<4096>::run(std::forward<Args>(args)...);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static constexpr int CAPACITY_MAX_N = 4096;
+static constexpr int CAPACITY_MAX_D = 128;
+
+#endif
@@ -0,0 +1,246 @@
+#ifndef CATALOGUE_H
+#define CATALOGUE_H
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+// A catalogue of known covers, keyed by (N, D), for programs that need a
+// cover for some N at startup without parsing diffcover.txt or searching.
+//
+// The file is mapped read-only and used in place: open() checks the header
+// and the bounds of every entry, after which find() is an array lookup by
+// N plus a scan over the few D stored for it, and a cover is a pointer
+// into the mapping.  Layout, native byte order (the endian field tells a
+// reader on a machine of the other order to refuse the file):
+//
+//   header   "DCC1", uint32 0x01020304, max N, number of entries, then
+//            uint64 offsets of the entries, the N table and the covers
+//   entries  CatalogueEntry sorted by (N, D)
+//   N table  uint32 first[max N + 2]: the entries of N are
+//            first[N] .. first[N + 1] - 1, so the smallest D comes first
+//   covers   uint16 a[1..D] per cover, a[D] = N, as the searches print them;
+//            the cover is {0, a[1], .., a[D - 1]} mod N
+//
+// CatalogueBuilder collects covers, checks that each one covers every
+// difference mod N, drops repeats and writes the file atomically.
+
+struct CatalogueEntry {
+    uint32_t N;
+    uint16_t D;
+    uint16_t flags;  // CATALOGUE_OPTIMAL if no smaller D exists for N
+    uint32_t count;  // covers stored
+    uint32_t reserved;
+    uint64_t offset;  // byte offset of the first cover in the file
+};
+static_assert(sizeof(CatalogueEntry) == 24, "CatalogueEntry is a file record");
+
+static constexpr uint16_t CATALOGUE_OPTIMAL = 1;
+
+struct CatalogueHeader {
+    char magic[4];
+    uint32_t endian;
+    uint32_t max_N;
+    uint32_t num_entries;
+    uint64_t entries_offset;
+    uint64_t first_offset;
+    uint64_t covers_offset;
+};
+static_assert(sizeof(CatalogueHeader) == 40, "CatalogueHeader is a file record");
+
+// True if {0, a[0], .., a[D - 2]} is a difference cover mod N, with
+// a[D - 1] == N as the searches print covers
+inline bool IsCover(int N, const int *a, int D) {
+    if (N < 1 || D < 1 || a[D - 1] != N) return false;
+    std::vector<int> elems(1, 0);
+    for (int idx = 0; idx < D - 1; ++idx) {
+        if (a[idx] <= elems.back() || a[idx] >= N) return false;
+        elems.push_back(a[idx]);
+    }
+    std::vector<bool> covered(N, false);
+    for (size_t i = 0; i < elems.size(); ++i) {
+        for (size_t j = 0; j < elems.size(); ++j) covered[(elems[i] - elems[j] + N) % N] = true;
+    }
+    for (int x = 0; x < N; ++x) {
+        if (!covered[x]) return false;
+    }
+    return true;
+}
+
+class Catalogue {
+  public:
+    Catalogue() : base(nullptr), length(0), header(nullptr), entries(nullptr), first(nullptr) {}
+    ~Catalogue() { close(); }
+    Catalogue(const Catalogue &) = delete;
+    Catalogue &operator=(const Catalogue &) = delete;
+
+    bool open(const char *path) {
+        close();
+        const int fd = ::open(path, O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(CatalogueHeader))) {
+            ::close(fd);
+            return false;
+        }
+        length = static_cast<size_t>(st.st_size);
+        void *map = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (map == MAP_FAILED) return false;
+        base = static_cast<const char *>(map);
+        if (!check()) {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close() {
+        if (base != nullptr) munmap(const_cast<char *>(base), length);
+        base = nullptr;
+        header = nullptr;
+        entries = nullptr;
+        first = nullptr;
+    }
+
+    int max_N() const { return header != nullptr ? static_cast<int>(header->max_N) : 0; }
+    size_t size() const { return header != nullptr ? header->num_entries : 0; }
+    const CatalogueEntry &entry(size_t idx) const { return entries[idx]; }
+
+    // The covers of (N, D), null if there are none
+    const CatalogueEntry *find(int N, int D) const {
+        if (header == nullptr || N < 0 || N > max_N()) return nullptr;
+        for (uint32_t idx = first[N]; idx < first[N + 1]; ++idx) {
+            if (entries[idx].D == D) return &entries[idx];
+        }
+        return nullptr;
+    }
+
+    // The covers of N with the smallest D, null if there are none
+    const CatalogueEntry *best(int N) const {
+        if (header == nullptr || N < 0 || N > max_N() || first[N] == first[N + 1]) return nullptr;
+        return &entries[first[N]];
+    }
+
+    // a[1..D] of the idx-th cover of `entry`, idx < entry.count
+    const uint16_t *cover(const CatalogueEntry &entry, uint32_t idx) const {
+        return reinterpret_cast<const uint16_t *>(base + entry.offset)
+               + static_cast<size_t>(idx) * entry.D;
+    }
+
+  private:
+    const char *base;
+    size_t length;
+    const CatalogueHeader *header;
+    const CatalogueEntry *entries;
+    const uint32_t *first;
+
+    bool within(uint64_t offset, uint64_t bytes) const {
+        return offset <= length && bytes <= length - offset;
+    }
+
+    bool check() {
+        const CatalogueHeader *head = reinterpret_cast<const CatalogueHeader *>(base);
+        if (memcmp(head->magic, "DCC1", 4) != 0 || head->endian != 0x01020304u
+            || !within(head->entries_offset, uint64_t(head->num_entries) * sizeof(CatalogueEntry))
+            || !within(head->first_offset, (uint64_t(head->max_N) + 2) * sizeof(uint32_t))
+            || head->entries_offset % 8 != 0 || head->first_offset % 4 != 0) {
+            return false;
+        }
+        const CatalogueEntry *table =
+            reinterpret_cast<const CatalogueEntry *>(base + head->entries_offset);
+        const uint32_t *by_N = reinterpret_cast<const uint32_t *>(base + head->first_offset);
+        for (uint32_t N = 0; N <= head->max_N; ++N) {
+            if (by_N[N] > by_N[N + 1]) return false;
+        }
+        if (by_N[head->max_N + 1] != head->num_entries) return false;
+        for (uint32_t idx = 0; idx < head->num_entries; ++idx) {
+            const CatalogueEntry &entry = table[idx];
+            if (entry.N > head->max_N || idx < by_N[entry.N] || idx >= by_N[entry.N + 1]
+                || entry.offset % 2 != 0
+                || !within(entry.offset, uint64_t(entry.count) * entry.D * sizeof(uint16_t))) {
+                return false;
+            }
+        }
+        header = head;
+        entries = table;
+        first = by_N;
+        return true;
+    }
+};
+
+class CatalogueBuilder {
+  public:
+    // Adds a[1..D] of a cover of N; false (and nothing added) if it is none
+    bool add(int N, const int *a, int D, bool optimal = false) {
+        if (N > 0xffff || D > 0xffff || !IsCover(N, a, D)) return false;
+        Covers &covers = table[std::make_pair(N, D)];
+        covers.set.insert(std::vector<uint16_t>(a, a + D));
+        covers.optimal = covers.optimal || optimal;
+        return true;
+    }
+
+    // Writes `path`.tmp and renames it over `path`
+    bool write(const char *path) const {
+        CatalogueHeader head;
+        memcpy(head.magic, "DCC1", 4);
+        head.endian = 0x01020304u;
+        head.max_N = table.empty() ? 0 : table.rbegin()->first.first;
+        head.num_entries = static_cast<uint32_t>(table.size());
+        head.entries_offset = sizeof(CatalogueHeader);
+        head.first_offset = head.entries_offset + table.size() * sizeof(CatalogueEntry);
+        head.covers_offset = head.first_offset + (uint64_t(head.max_N) + 2) * sizeof(uint32_t);
+
+        std::vector<CatalogueEntry> entries;
+        std::vector<uint32_t> first(head.max_N + 2, 0);
+        std::vector<uint16_t> covers;
+        for (Table::const_iterator it = table.begin(); it != table.end(); ++it) {
+            CatalogueEntry entry;
+            entry.N = it->first.first;
+            entry.D = static_cast<uint16_t>(it->first.second);
+            entry.flags = it->second.optimal ? CATALOGUE_OPTIMAL : 0;
+            entry.count = static_cast<uint32_t>(it->second.set.size());
+            entry.reserved = 0;
+            entry.offset = head.covers_offset + covers.size() * sizeof(uint16_t);
+            for (std::set<std::vector<uint16_t>>::const_iterator cover = it->second.set.begin();
+                 cover != it->second.set.end(); ++cover) {
+                covers.insert(covers.end(), cover->begin(), cover->end());
+            }
+            ++first[entry.N + 1];
+            entries.push_back(entry);
+        }
+        for (uint32_t N = 1; N < first.size(); ++N) first[N] += first[N - 1];
+
+        const std::string tmp = std::string(path) + ".tmp";
+        FILE *file = fopen(tmp.c_str(), "wb");
+        if (file == nullptr) return false;
+        bool ok = fwrite(&head, sizeof(head), 1, file) == 1
+                  && fwrite(entries.data(), sizeof(CatalogueEntry), entries.size(), file)
+                         == entries.size()
+                  && fwrite(first.data(), sizeof(uint32_t), first.size(), file) == first.size()
+                  && fwrite(covers.data(), sizeof(uint16_t), covers.size(), file) == covers.size()
+                  && fflush(file) == 0 && fsync(fileno(file)) == 0;
+        ok = fclose(file) == 0 && ok;
+        return ok && rename(tmp.c_str(), path) == 0;
+    }
+
+  private:
+    struct Covers {
+        std::set<std::vector<uint16_t>> set;
+        bool optimal = false;
+    };
+    typedef std::map<std::pair<int, int>, Covers> Table;
+    Table table;
+};
+
+#endif
@@ -0,0 +1,288 @@
+#ifndef COVER_SINK_H
+#define COVER_SINK_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "CoverStream.h"
+
+// Output of the covers a search finds.
+//
+// Printing every cover with printf and fflush from the workers serializes
+// them on the stdio lock, costs a write() per cover and lets the lines of
+// different threads interleave.  Here every search encodes its covers into
+// a Buffer of its own and hands the buffer to the sink as one chunk once it
+// holds CHUNK bytes or when the search ends or pauses.  A writer thread
+// writes the chunks in the order they arrive and flushes the file whenever
+// it runs out of chunks, so chunks are never torn.  Once every STALE it
+// also takes the contents of each registered buffer whose oldest cover is
+// older than STALE, skipping buffers their search is busy with, so a cover
+// found early in a long search reaches the file within about two STALE
+// even if the search finds nothing more.  Threads block in write() while
+// MAX_QUEUED chunks wait, so a slow disk slows the search down instead of
+// filling memory.
+//
+// Formats, each cover being the D values a[1..D]:
+//   text     "\n" and "%3d " per value and "\n", as the programs always printed
+//   binary   "DCB1", int32 N and D, then D little-endian uint16 per cover;
+//            the header is left out when appending to a non-empty file
+//   ndjson   one JSON array per line, e.g. [1,3,7]
+//   compact  varint gaps in indexed blocks (see CoverStream.h); the index is
+//            written when the sink is destroyed, so it cannot be appended to
+enum class CoverFormat { Text, Binary, Json, Compact };
+
+class CoverSink {
+  public:
+    static constexpr size_t CHUNK = 1 << 16;
+    static constexpr size_t MAX_QUEUED = 64;
+    static constexpr std::chrono::seconds STALE{1};
+
+    // Covers of one search, encoded in the sink's format.  Only the thread
+    // running the search writes to it; the lock is there for the writer
+    // thread taking stale covers and is uncontended otherwise.  Without a
+    // sink every cover is printed straight to stdout as text.
+    class Buffer {
+      public:
+        explicit Buffer(CoverSink *sink) : sink(sink) {
+            if (sink != nullptr) sink->attach(this);
+        }
+        ~Buffer() {
+            flush();
+            if (sink != nullptr) sink->detach(this);
+        }
+        Buffer(const Buffer &) = delete;
+        Buffer &operator=(const Buffer &) = delete;
+
+        // Appends the cover cover[0..D-1]
+        void put(const int *cover, int D) {
+            std::lock_guard<std::mutex> guard(lock);
+            if (data.empty()) oldest = std::chrono::steady_clock::now();
+            CoverSink::encode(sink != nullptr ? sink->format : CoverFormat::Text,
+                              sink != nullptr ? sink->width : 3, cover, D, data);
+            if (sink == nullptr || data.size() >= CHUNK) hand_over();
+        }
+
+        void flush() {
+            std::lock_guard<std::mutex> guard(lock);
+            hand_over();
+        }
+
+      private:
+        friend class CoverSink;
+
+        CoverSink *sink;
+        std::mutex lock;
+        std::string data;
+        std::chrono::steady_clock::time_point oldest;
+
+        void hand_over() {
+            if (data.empty()) return;
+            if (sink != nullptr) {
+                sink->write(data);
+            } else {
+                fwrite(data.data(), 1, data.size(), stdout);
+                fflush(stdout);
+                data.clear();
+            }
+        }
+
+        // Writer thread, with the sink's mutex held: queues the covers if
+        // the oldest was found before `cutoff` and the search is not busy
+        // with the buffer
+        void take_stale(std::chrono::steady_clock::time_point cutoff,
+                        std::deque<std::string> &chunks) {
+            std::unique_lock<std::mutex> guard(lock, std::try_to_lock);
+            if (!guard.owns_lock() || data.empty() || oldest > cutoff) return;
+            chunks.push_back(std::move(data));
+            data.clear();
+        }
+    };
+
+    // Writes to `file`, which stays open; `width` is the field width of the
+    // text format (0 for "%d ")
+    CoverSink(FILE *file, CoverFormat format, int N, int D, int width = 3)
+        : format(format),
+          width(width),
+          num_D(D),
+          file(file),
+          stop(false),
+          busy(false),
+          written(0),
+          covers(0),
+          gaps(0) {
+        if (format == CoverFormat::Binary && ftell(file) <= 0) {
+            const int32_t head[2] = {N, D};
+            fwrite("DCB1", 1, 4, file);
+            fwrite(head, sizeof(int32_t), 2, file);
+        } else if (format == CoverFormat::Compact) {
+            const std::string head = CoverStream::header(N, D);
+            fwrite(head.data(), 1, head.size(), file);
+            written = head.size();
+        }
+        writer = std::thread([this]() { run(); });
+    }
+
+    ~CoverSink() {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            stop = true;
+        }
+        ready.notify_one();
+        writer.join();
+        if (format == CoverFormat::Compact) {
+            const std::string footer = CoverStream::footer(blocks, written, covers);
+            fwrite(footer.data(), 1, footer.size(), file);
+        }
+        fflush(file);
+    }
+
+    CoverSink(const CoverSink &) = delete;
+    CoverSink &operator=(const CoverSink &) = delete;
+
+    // Queues `chunk` for the writer and leaves it empty
+    void write(std::string &chunk) {
+        std::string taken;
+        taken.swap(chunk);
+        std::unique_lock<std::mutex> lock(mutex);
+        drained.wait(lock, [this]() { return chunks.size() < MAX_QUEUED; });
+        chunks.push_back(std::move(taken));
+        ready.notify_one();
+    }
+
+    // Blocks until every chunk queued so far is written and flushed
+    void flush() {
+        std::unique_lock<std::mutex> lock(mutex);
+        drained.wait(lock, [this]() { return chunks.empty() && !busy; });
+        fflush(file);
+    }
+
+    FILE *output() const { return file; }
+
+    static void encode(CoverFormat format, int width, const int *cover, int D, std::string &out) {
+        char text[16];
+        switch (format) {
+            case CoverFormat::Text:
+                out += '\n';
+                for (int idx = 0; idx < D; ++idx) {
+                    out.append(text, snprintf(text, sizeof(text), "%*d ", width, cover[idx]));
+                }
+                out += '\n';
+                break;
+            case CoverFormat::Binary:
+                for (int idx = 0; idx < D; ++idx) {
+                    out += static_cast<char>(cover[idx] & 0xff);
+                    out += static_cast<char>(cover[idx] >> 8 & 0xff);
+                }
+                break;
+            case CoverFormat::Compact:
+                CoverStream::put_cover(out, cover, D);
+                break;
+            case CoverFormat::Json:
+                out += '[';
+                for (int idx = 0; idx < D; ++idx) {
+                    out.append(text, snprintf(text, sizeof(text), idx > 0 ? ",%d" : "%d",
+                                              cover[idx]));
+                }
+                out += "]\n";
+                break;
+        }
+    }
+
+  private:
+    const CoverFormat format;
+    const int width;
+    const int num_D;
+    FILE *const file;
+    std::mutex mutex;
+    std::condition_variable ready;    // a chunk arrived or stop was raised
+    std::condition_variable drained;  // a chunk was taken or written
+    std::deque<std::string> chunks;
+    bool stop;
+    bool busy;  // the writer holds a chunk it has not finished writing
+    std::vector<Buffer *> buffers;  // the buffers writing to this sink
+    std::thread writer;
+
+    // Compact format, writer thread only: bytes written so far, covers and
+    // varints of the current cover seen so far, and where each block starts
+    uint64_t written;
+    uint64_t covers;
+    int gaps;
+    std::vector<uint64_t> blocks;
+
+    // Notes the blocks that start in `chunk`, which goes at offset `written`
+    void index(const std::string &chunk) {
+        for (size_t pos = 0; pos < chunk.size(); ++pos) {
+            if (gaps == 0 && covers == blocks.size() * CoverStream::COVERS_PER_BLOCK) {
+                blocks.push_back(written + pos);
+            }
+            if ((chunk[pos] & 0x80) != 0) continue;
+            if (++gaps == num_D) {
+                gaps = 0;
+                ++covers;
+            }
+        }
+        written += chunk.size();
+    }
+
+    void attach(Buffer *buffer) {
+        std::lock_guard<std::mutex> lock(mutex);
+        buffers.push_back(buffer);
+    }
+
+    void detach(Buffer *buffer) {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (size_t idx = 0; idx < buffers.size(); ++idx) {
+            if (buffers[idx] == buffer) {
+                buffers[idx] = buffers.back();
+                buffers.pop_back();
+                break;
+            }
+        }
+    }
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex);
+        auto sweep = std::chrono::steady_clock::now() + STALE;
+        for (;;) {
+            ready.wait_until(lock, sweep, [this]() { return stop || !chunks.empty(); });
+            const auto now = std::chrono::steady_clock::now();
+            if (now >= sweep) {
+                for (Buffer *buffer : buffers) buffer->take_stale(now - STALE, chunks);
+                sweep = now + STALE;
+            }
+            if (chunks.empty()) {
+                if (stop) return;
+                continue;
+            }
+            std::string chunk;
+            chunk.swap(chunks.front());
+            chunks.pop_front();
+            busy = true;
+            drained.notify_all();
+            lock.unlock();
+            if (format == CoverFormat::Compact) index(chunk);
+            fwrite(chunk.data(), 1, chunk.size(), file);
+            lock.lock();
+            if (chunks.empty()) {
+                lock.unlock();
+                fflush(file);
+                lock.lock();
+            }
+            busy = false;
+            drained.notify_all();
+        }
+    }
+};
+
+constexpr size_t CoverSink::CHUNK;
+constexpr size_t CoverSink::MAX_QUEUED;
+constexpr std::chrono::seconds CoverSink::STALE;
+
+#endif
@@ -0,0 +1,316 @@
+#ifndef COVER_STREAM_H
+#define COVER_STREAM_H
+
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Compact cover files ("DCZ1").
+//
+// A cover is an increasing set a[1..D] of positions up to N; consecutive
+// positions are close, so a cover is stored as its D gaps a[1] - 0,
+// a[2] - a[1], ... in LEB128 varints, one byte each below 128.  A 10-set
+// takes 10 bytes instead of the 40 of its text line.  The file is
+//
+//   header   "DCZ1", uint32 N, D and covers per block
+//   blocks   the covers in the order they were written, COVERS_PER_BLOCK
+//            to a block, the last block with the rest
+//   index    uint64 file offset of every block
+//   trailer  uint64 index offset, number of blocks, number of covers, "DCZI"
+//
+// all little-endian.  The writer (CoverSink with CoverFormat::Compact)
+// only knows the index once the run is over, so it goes last; a reader
+// finds it through the fixed-size trailer and reaches cover k by decoding
+// at most one block.  A file cut short before the index, by a killed run,
+// still reads from front to back up to the last whole cover.
+
+namespace CoverStream {
+
+static constexpr uint32_t COVERS_PER_BLOCK = 4096;
+static constexpr long HEADER_SIZE = 16;
+static constexpr long TRAILER_SIZE = 28;
+
+inline void put_u32(std::string &out, uint32_t value) {
+    for (int shift = 0; shift < 32; shift += 8) out += static_cast<char>(value >> shift & 0xff);
+}
+
+inline void put_u64(std::string &out, uint64_t value) {
+    for (int shift = 0; shift < 64; shift += 8) out += static_cast<char>(value >> shift & 0xff);
+}
+
+inline uint64_t get_le(const unsigned char *pos, int bytes) {
+    uint64_t value = 0;
+    for (int idx = bytes - 1; idx >= 0; --idx) value = value << 8 | pos[idx];
+    return value;
+}
+
+inline void put_varint(std::string &out, uint32_t value) {
+    while (value >= 0x80) {
+        out += static_cast<char>((value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    out += static_cast<char>(value);
+}
+
+// The gaps of cover[0..D-1]
+inline void put_cover(std::string &out, const int *cover, int D) {
+    int last = 0;
+    for (int idx = 0; idx < D; ++idx) {
+        put_varint(out, static_cast<uint32_t>(cover[idx] - last));
+        last = cover[idx];
+    }
+}
+
+inline std::string header(int N, int D) {
+    std::string out("DCZ1");
+    put_u32(out, N);
+    put_u32(out, D);
+    put_u32(out, COVERS_PER_BLOCK);
+    return out;
+}
+
+// Index and trailer of a file whose blocks start at `blocks`
+inline std::string footer(const std::vector<uint64_t> &blocks, uint64_t index_offset,
+                          uint64_t covers) {
+    std::string out;
+    for (size_t idx = 0; idx < blocks.size(); ++idx) put_u64(out, blocks[idx]);
+    put_u64(out, index_offset);
+    put_u64(out, blocks.size());
+    put_u64(out, covers);
+    out += "DCZI";
+    return out;
+}
+
+}  // namespace CoverStream
+
+// Reads covers back from a compact file, from the fixed-width binary
+// format of CoverSink ("DCB1") or from text output, one cover per line
+// (the lines the searches print; other lines, such as "Number of
+// workers", are skipped).  Text carries no header, so N and D come from the
+// first cover: its length and its last value, which the searches always
+// print as N.
+class CoverReader {
+  public:
+    enum Kind { Compact, Binary, Text };
+
+    CoverReader() : file(nullptr) {}
+    ~CoverReader() { close(); }
+    CoverReader(const CoverReader &) = delete;
+    CoverReader &operator=(const CoverReader &) = delete;
+
+    bool open(const char *path) {
+        close();
+        file = fopen(path, "rb");
+        if (file == nullptr) return false;
+        setvbuf(file, nullptr, _IOFBF, 1 << 20);
+        num_N = num_D = 0;
+        num_covers = -1;
+        position = 0;
+        blocks.clear();
+        pending.clear();
+        fseek(file, 0, SEEK_END);
+        const long length = ftell(file);
+        fseek(file, 0, SEEK_SET);
+
+        unsigned char head[CoverStream::HEADER_SIZE];
+        const size_t got = fread(head, 1, sizeof(head), file);
+        if (got >= 12 && memcmp(head, "DCB1", 4) == 0) {
+            kind = Binary;
+            int32_t dims[2];
+            memcpy(dims, head + 4, sizeof(dims));
+            num_N = dims[0];
+            num_D = dims[1];
+            data_start = 12;
+            if (num_D <= 0) return fail();
+            num_covers = (length - data_start) / (2 * num_D);
+            return fseek(file, data_start, SEEK_SET) == 0;
+        }
+        if (got == sizeof(head) && memcmp(head, "DCZ1", 4) == 0) {
+            kind = Compact;
+            num_N = static_cast<int>(CoverStream::get_le(head + 4, 4));
+            num_D = static_cast<int>(CoverStream::get_le(head + 8, 4));
+            per_block = CoverStream::get_le(head + 12, 4);
+            data_start = CoverStream::HEADER_SIZE;
+            data_end = length;
+            if (num_D <= 0 || per_block == 0) return fail();
+            read_index(length);
+            offset = data_start;
+            return fseek(file, data_start, SEEK_SET) == 0;
+        }
+        // text: find the first cover for N and D, then start over
+        kind = Text;
+        fseek(file, 0, SEEK_SET);
+        std::vector<int> cover;
+        while (next_line(cover)) {
+            if (cover.size() < 3) continue;
+            num_D = static_cast<int>(cover.size());
+            num_N = cover.back();
+            pending = cover;
+            return true;
+        }
+        return fail();
+    }
+
+    void close() {
+        if (file != nullptr) fclose(file);
+        file = nullptr;
+    }
+
+    Kind format() const { return kind; }
+    int N() const { return num_N; }
+    int D() const { return num_D; }
+    // Number of covers, -1 if only reading them all tells
+    long long size() const { return num_covers; }
+    bool indexed() const { return !blocks.empty() || (kind == Compact && num_covers == 0); }
+
+    // Reads the next cover into cover[0..D-1]; false at the end
+    bool next(int *cover) {
+        if (file == nullptr) return false;
+        switch (kind) {
+            case Binary: {
+                unsigned char raw[2 * 256];
+                if (num_D > 256 || fread(raw, 2, num_D, file) != static_cast<size_t>(num_D)) {
+                    return false;
+                }
+                for (int idx = 0; idx < num_D; ++idx) {
+                    cover[idx] = raw[2 * idx] | raw[2 * idx + 1] << 8;
+                }
+                break;
+            }
+            case Compact: {
+                if (num_covers >= 0 && position >= num_covers) return false;
+                int last = 0;
+                for (int idx = 0; idx < num_D; ++idx) {
+                    uint32_t gap = 0;
+                    for (int shift = 0;; shift += 7) {
+                        const int byte = offset < data_end ? getc(file) : EOF;
+                        ++offset;
+                        if (byte == EOF || shift > 28) return false;
+                        gap |= static_cast<uint32_t>(byte & 0x7f) << shift;
+                        if ((byte & 0x80) == 0) break;
+                    }
+                    last += static_cast<int>(gap);
+                    cover[idx] = last;
+                }
+                break;
+            }
+            case Text: {
+                std::vector<int> line;
+                if (!pending.empty()) {
+                    line.swap(pending);
+                } else {
+                    do {
+                        if (!next_line(line)) return false;
+                    } while (static_cast<int>(line.size()) != num_D);
+                }
+                std::copy(line.begin(), line.end(), cover);
+                break;
+            }
+        }
+        ++position;
+        return true;
+    }
+
+    // Makes next() return cover k; needs the index of a compact file
+    bool seek(long long k) {
+        if (file == nullptr || k < 0 || (num_covers >= 0 && k > num_covers)) return false;
+        if (kind == Binary) {
+            position = k;
+            return fseek(file, data_start + k * 2 * num_D, SEEK_SET) == 0;
+        }
+        if (kind != Compact || !indexed()) return false;
+        const long long block = k / per_block;
+        if (block >= static_cast<long long>(blocks.size())) {
+            position = k;
+            offset = data_end;
+            return fseek(file, data_end, SEEK_SET) == 0;
+        }
+        offset = static_cast<long>(blocks[block]);
+        if (fseek(file, offset, SEEK_SET) != 0) return false;
+        position = block * per_block;
+        std::vector<int> skip(num_D);
+        while (position < k) {
+            if (!next(skip.data())) return false;
+        }
+        return true;
+    }
+
+  private:
+    FILE *file;
+    Kind kind;
+    int num_N;
+    int num_D;
+    long long num_covers;
+    long long position;  // number of the cover next() returns
+    long data_start;
+    long data_end;  // where the blocks of a compact file end
+    long offset;    // file offset of a compact file's next byte
+    uint64_t per_block;
+    std::vector<uint64_t> blocks;  // offsets of the blocks of a compact file
+    std::vector<int> pending;      // first text cover, read by open()
+
+    bool fail() {
+        close();
+        return false;
+    }
+
+    // Checks the trailer and loads the index; leaves the file unindexed if
+    // either is missing or inconsistent
+    void read_index(long length) {
+        if (length < CoverStream::HEADER_SIZE + CoverStream::TRAILER_SIZE) return;
+        unsigned char tail[CoverStream::TRAILER_SIZE];
+        if (fseek(file, length - CoverStream::TRAILER_SIZE, SEEK_SET) != 0
+            || fread(tail, 1, sizeof(tail), file) != sizeof(tail)
+            || memcmp(tail + 24, "DCZI", 4) != 0) {
+            return;
+        }
+        const uint64_t index_offset = CoverStream::get_le(tail, 8);
+        const uint64_t num_blocks = CoverStream::get_le(tail + 8, 8);
+        const uint64_t covers = CoverStream::get_le(tail + 16, 8);
+        if (index_offset < static_cast<uint64_t>(CoverStream::HEADER_SIZE)
+            || index_offset + 8 * num_blocks + CoverStream::TRAILER_SIZE
+                   != static_cast<uint64_t>(length)
+            || (covers + per_block - 1) / per_block != num_blocks) {
+            return;
+        }
+        std::vector<unsigned char> raw(8 * num_blocks);
+        if (fseek(file, static_cast<long>(index_offset), SEEK_SET) != 0
+            || fread(raw.data(), 1, raw.size(), file) != raw.size()) {
+            return;
+        }
+        blocks.resize(num_blocks);
+        for (uint64_t idx = 0; idx < num_blocks; ++idx) {
+            blocks[idx] = CoverStream::get_le(&raw[8 * idx], 8);
+        }
+        data_end = static_cast<long>(index_offset);
+        num_covers = static_cast<long long>(covers);
+    }
+
+    // The numbers on the next line, empty for a line that is not a cover.
+    // A carriage return starts over, as it does on a terminal: the searches
+    // count down the open tasks with "%3d\r" in between the covers.
+    bool next_line(std::vector<int> &cover) {
+        cover.clear();
+        char buf[4096];
+        if (fgets(buf, sizeof(buf), file) == nullptr) return false;
+        for (char *pos = buf; *pos != '\0' && *pos != '\n';) {
+            if (*pos == '\r') cover.clear();
+            if (*pos == ' ' || *pos == '\t' || *pos == '\r') {
+                ++pos;
+                continue;
+            }
+            if (!isdigit(static_cast<unsigned char>(*pos))) {
+                cover.clear();
+                return true;
+            }
+            cover.push_back(static_cast<int>(strtol(pos, &pos, 10)));
+        }
+        return true;
+    }
+};
+
+#endif
@@ -0,0 +1,300 @@
+#ifndef DIFF_SET_H
+#define DIFF_SET_H
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Difference-tracking states for DcGenerator.
+//
+// Both states record which folded differences min(d, N - d) are realized by
+// the chosen positions a[0..t] and report, through `count`, how many of the
+// values 1..N/2 are covered.  step_forward/step_backward are always called in
+// LIFO order with a[0..t-1] already stepped forward.  Both are sized by a
+// capacity class (see Capacity.h): N <= MaxN and t < MaxD.  N is passed to
+// every step so that it folds to a constant in the specialized kernels.
+
+// Function multiversioning for the search loops that drive these states.
+// Built with -DDC_CLONES, GCC emits one clone of each marked function per
+// target below and the loader picks the widest one the CPU supports, so a
+// portable binary runs the inlined step kernels with AVX-512 or AVX2 where
+// available.  It is opt-in: with D <= 16 the vector loops rarely fill a
+// register and the wide clones measured slower than the scalar build.
+#if defined(DC_CLONES) && defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__)
+#define DC_MULTIVERSION __attribute__((target_clones("avx512f", "avx2", "sse4.2", "default")))
+#else
+#define DC_MULTIVERSION
+#endif
+
+// Widest vector extension a DC_MULTIVERSION clone uses on this CPU
+inline const char *SimdLevel() {
+#if defined(DC_CLONES) && defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__)
+    if (__builtin_cpu_supports("avx512f")) return "avx512f";
+    if (__builtin_cpu_supports("avx2")) return "avx2";
+    if (__builtin_cpu_supports("sse4.2")) return "sse4.2";
+    return "default";
+#else
+    return "build target";
+#endif
+}
+
+// Keeps a hot helper inside every clone of its DC_MULTIVERSION caller
+#if defined(__GNUC__)
+#define DC_INLINE inline __attribute__((always_inline))
+#else
+#define DC_INLINE inline
+#endif
+
+// One counter per folded difference: O(t) scattered increments per node.
+// The folded differences of a[t] are computed in a separate pass that the
+// compiler can vectorize (see DC_MULTIVERSION) and kept per depth, so the
+// backward step only replays the decrements.
+template <int MaxN, int MaxD>
+class CounterDiffs {
+  private:
+    int differences[MaxN / 2 + 1];
+    int folded[MaxD][MaxD];  // folded[t][idx]: min(d, N - d) of a[t] - a[idx]
+
+  public:
+    static const char *name() { return "counter"; }
+
+    void init(int /* N */) {
+        std::memset(differences, 0, sizeof(differences));
+        differences[0] = 1;
+    }
+
+    DC_INLINE void step_forward(const int *a, int t, int N, int &count) {
+        const int at = a[t];
+        int *diffs = folded[t];
+        for (int idx = 0; idx < t; ++idx) {
+            const int p_diff = at - a[idx];
+            const int n_diff = N - p_diff;
+            diffs[idx] = p_diff < n_diff ? p_diff : n_diff;
+        }
+        for (int idx = 0; idx < t; ++idx) {
+            // Note that p_diff may be equal to n_diff
+            if (differences[diffs[idx]]++ == 0) {
+                ++count;
+            }
+        }
+    }
+
+    DC_INLINE void step_backward(const int * /* a */, int t, int /* N */) {
+        const int *diffs = folded[t];
+        for (int idx = 0; idx < t; ++idx) --differences[diffs[idx]];
+    }
+
+    // number of covered folded differences in [lo, hi]
+    int covered_in(int lo, int hi) const {
+        int covered = 0;
+        for (int diff = lo; diff <= hi; ++diff) covered += differences[diff] != 0;
+        return covered;
+    }
+
+    // lists the `num` uncovered folded differences in 1..N/2
+    void uncovered(int N, int num, int *out) const {
+        for (int diff = 1, found = 0; found < num && diff <= N / 2; ++diff) {
+            if (differences[diff] == 0) out[found++] = diff;
+        }
+    }
+};
+
+// 64-bit-word bitsets.  Because a[] is increasing, the differences of a new
+// element x against a[0..t-1] need no wrap-around: `reversed` holds
+// {M - a[idx]}, so (reversed >> (M - x)) yields every x - a[idx], and
+// (chosen << (N - x)) yields every N - x + a[idx].  Masking with 1..N/2 keeps
+// the folded half of each pair, so a node costs two shifts, an OR and a
+// popcount instead of one counter per pair.  Coverage is not invertible, so
+// each depth keeps a snapshot of `covered` to restore on the way back.
+template <int MaxN, int MaxD>
+class BitsetDiffs {
+  private:
+    static constexpr int W = (MaxN + 63) / 64;
+    static constexpr int M = 64 * W - 1;
+
+    uint64_t chosen[W];    // {a[0..t-1]}
+    uint64_t reversed[W];  // {M - a[0..t-1]}
+    uint64_t covered[W];   // folded differences, bits 1..N/2
+    uint64_t half[W];      // bits 1..N/2
+    uint64_t saved[MaxD + 1][W];
+
+    static inline void set_bit(uint64_t *s, int b) { s[b >> 6] |= uint64_t(1) << (b & 63); }
+    static inline void clear_bit(uint64_t *s, int b) { s[b >> 6] &= ~(uint64_t(1) << (b & 63)); }
+
+    // word idx of (src >> k), k = 64 * ws + bs
+    static inline uint64_t shr_word(const uint64_t *src, int ws, int bs, int idx) {
+        const int j = idx + ws;
+        if (j >= W) return 0;
+        uint64_t w = src[j] >> bs;
+        if (bs != 0 && j + 1 < W) w |= src[j + 1] << (64 - bs);
+        return w;
+    }
+
+    // word idx of (src << k), k = 64 * ws + bs
+    static inline uint64_t shl_word(const uint64_t *src, int ws, int bs, int idx) {
+        const int j = idx - ws;
+        if (j < 0) return 0;
+        uint64_t w = src[j] << bs;
+        if (bs != 0 && j > 0) w |= src[j - 1] >> (64 - bs);
+        return w;
+    }
+
+  public:
+    static const char *name() { return "bitset"; }
+
+    void init(int N) {
+        std::memset(chosen, 0, sizeof(chosen));
+        std::memset(reversed, 0, sizeof(reversed));
+        std::memset(covered, 0, sizeof(covered));
+        std::memset(half, 0, sizeof(half));
+        for (int b = 1; b <= N / 2; ++b) set_bit(half, b);
+        set_bit(chosen, 0);
+        set_bit(reversed, M);
+    }
+
+    DC_INLINE void step_forward(const int *a, int t, int N, int &count) {
+        const int at = a[t];
+        const int rs = M - at;
+        const int ls = N - at;
+        const int hw = N / 2 / 64 + 1;  // words holding bits 1..N/2
+        int pop = 0;
+        for (int idx = 0; idx < hw; ++idx) {
+            const uint64_t fresh = (shr_word(reversed, rs >> 6, rs & 63, idx)
+                                    | shl_word(chosen, ls >> 6, ls & 63, idx))
+                                   & half[idx];
+            saved[t][idx] = covered[idx];
+            covered[idx] |= fresh;
+            pop += __builtin_popcountll(covered[idx]);
+        }
+        count = pop;
+        set_bit(chosen, at);
+        set_bit(reversed, M - at);
+    }
+
+    DC_INLINE void step_backward(const int *a, int t, int N) {
+        const int at = a[t];
+        const int hw = N / 2 / 64 + 1;
+        clear_bit(chosen, at);
+        clear_bit(reversed, M - at);
+        for (int idx = 0; idx < hw; ++idx) covered[idx] = saved[t][idx];
+    }
+
+    // number of covered folded differences in [lo, hi]
+    int covered_in(int lo, int hi) const {
+        int pop = 0;
+        for (int idx = lo >> 6; idx <= hi >> 6; ++idx) {
+            uint64_t word = covered[idx];
+            if (idx == lo >> 6) word &= ~uint64_t(0) << (lo & 63);
+            if (idx == hi >> 6 && (hi & 63) != 63) word &= (uint64_t(2) << (hi & 63)) - 1;
+            pop += __builtin_popcountll(word);
+        }
+        return pop;
+    }
+
+    // lists the `num` uncovered folded differences in 1..N/2
+    void uncovered(int N, int /* num */, int *out) const {
+        const int hw = N / 2 / 64 + 1;
+        int found = 0;
+        for (int idx = 0; idx < hw; ++idx) {
+            for (uint64_t open = half[idx] & ~covered[idx]; open != 0; open &= open - 1) {
+                out[found++] = 64 * idx + __builtin_ctzll(open);
+            }
+        }
+    }
+};
+
+// Residue projections for composite N.  If S covers Z_N then S mod m covers
+// Z_m for every divisor m, so each divisor 3 <= m <= 64 keeps the residues
+// of a[0..t] and the differences they cover as m-bit masks (both d and m - d
+// set), snapshotted per depth like BitsetDiffs.  The snapshots are sized by
+// the divisors and depths in use and only allocated when the bound is on,
+// so a generator without it stays small.  feasible() checks that the
+// r elements still to place can close every projection: one of them covers
+// at most the best single residue's share of the open differences against
+// a[0..t], and pairs among them at most r(r-1)/2 more.
+class ProjectedDiffs {
+  private:
+    static constexpr int MAX_DIVISORS = 32;
+
+    int num;  // divisors in use
+    int m[MAX_DIVISORS];
+    uint64_t full[MAX_DIVISORS];  // bits 0..m-1
+    uint64_t low[MAX_DIVISORS];   // bits 1..m/2
+    uint64_t residues[MAX_DIVISORS];  // {a[idx] mod m}
+    uint64_t negated[MAX_DIVISORS];   // {-a[idx] mod m}
+    uint64_t covered[MAX_DIVISORS];
+    std::vector<uint64_t> saved;  // residues, negated, covered per depth and divisor
+
+    // x rotated left by k within m bits
+    static inline uint64_t rotate(uint64_t x, int k, int m, uint64_t full) {
+        if (k == 0) return x;
+        return ((x << k) | (x >> (m - k))) & full;
+    }
+
+    // Differences rho - s and s - rho mod m[idx] against every residue s
+    inline uint64_t differences(int idx, int rho) const {
+        return rotate(negated[idx], rho, m[idx], full[idx])
+               | rotate(residues[idx], rho == 0 ? 0 : m[idx] - rho, m[idx], full[idx]);
+    }
+
+  public:
+    // Takes the divisors of N for depths below D, or none unless `enabled`
+    void init(int N, int D, bool enabled) {
+        num = 0;
+        for (int div = 3; enabled && div <= 64 && div < N && num < MAX_DIVISORS; ++div) {
+            if (N % div != 0) continue;
+            m[num] = div;
+            full[num] = div == 64 ? ~uint64_t(0) : (uint64_t(1) << div) - 1;
+            low[num] = ((uint64_t(2) << (div / 2)) - 1) & ~uint64_t(1);
+            residues[num] = 1;  // a[0] = 0
+            negated[num] = 1;
+            covered[num] = 1;
+            ++num;
+        }
+        saved.assign(static_cast<size_t>(D) * 3 * num, 0);
+    }
+
+    // Nothing to check when N has no divisor in range
+    bool empty() const { return num == 0; }
+
+    inline void step_forward(const int *a, int t) {
+        uint64_t *snapshot = &saved[3 * num * t];
+        for (int idx = 0; idx < num; ++idx) {
+            const int rho = a[t] % m[idx];
+            snapshot[idx] = residues[idx];
+            snapshot[num + idx] = negated[idx];
+            snapshot[2 * num + idx] = covered[idx];
+            covered[idx] |= differences(idx, rho);
+            residues[idx] |= uint64_t(1) << rho;
+            negated[idx] |= uint64_t(1) << (rho == 0 ? 0 : m[idx] - rho);
+        }
+    }
+
+    inline void step_backward(int t) {
+        const uint64_t *snapshot = &saved[3 * num * t];
+        for (int idx = 0; idx < num; ++idx) {
+            residues[idx] = snapshot[idx];
+            negated[idx] = snapshot[num + idx];
+            covered[idx] = snapshot[2 * num + idx];
+        }
+    }
+
+    // Whether r more elements can still cover every Z_m
+    bool feasible(int r) const {
+        const int among = r * (r - 1) / 2;
+        for (int idx = 0; idx < num; ++idx) {
+            const uint64_t open = low[idx] & ~covered[idx];
+            const int need = __builtin_popcountll(open);
+            if (need <= among) continue;
+            int best = 0;
+            for (int rho = 0; rho < m[idx] && r * best + among < need; ++rho) {
+                const int gain = __builtin_popcountll(differences(idx, rho) & open);
+                if (gain > best) best = gain;
+            }
+            if (r * best + among < need) return false;
+        }
+        return true;
+    }
+};
+
+#endif
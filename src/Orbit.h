@@ -0,0 +1,126 @@
+#ifndef ORBIT_H
+#define ORBIT_H
+
+#include <algorithm>
+#include <vector>
+
+// Affine symmetry of difference covers.
+//
+// x -> kx + c with gcd(k, N) = 1 maps a cover of Z_N onto a cover.  The
+// generators emit one set per rotation class (the translations x + c;
+// mirror images are both reported), and AffineOrbits keeps one of those per
+// orbit of the full affine group.  A rotation class is identified by its
+// canonical gap sequence, the lexicographically largest rotation of the
+// cyclic gaps, and the leader of an orbit is the class with the largest one.
+// The full check costs O(phi(N) D^2) per cover and runs on valid leaves.
+//
+// Its first entry is the largest gap, which `beaten` uses to cut partial
+// covers a[0..t] whose other r elements lie in (a[t], N).  No completion
+// S has a gap wider than the widest known one or N - a[t] - r.  Two images
+// k a[i], k a[j] with no k x, x in (a[t], N), between them are neighbours
+// in k S for every completion; if they are further apart than that, no
+// leaf below leads its orbit.  Testing every k would cost phi(N) t per
+// node, more than the cuts save, so only the smallest k is tried; on the
+// rows timed it still removes most of the nodes all of them would.
+template <int MaxD>
+class AffineOrbits {
+  private:
+    int N;
+    int D;
+    std::vector<int> units;  // k in [2, N - 1] with gcd(k, N) = 1
+    int image[MaxD];
+    int gaps[MaxD];
+    int own[MaxD];
+    int other[MaxD];
+    int probe;    // the multiplier `beaten` tries, units[0]
+    int inverse;  // of probe modulo N
+
+    static int gcd(int x, int y) {
+        while (y != 0) {
+            const int r = x % y;
+            x = y;
+            y = r;
+        }
+        return x;
+    }
+
+    // Canonical gap sequence of the D residues in image[] into out[]
+    void Canonical(int *out) {
+        std::sort(image, image + D);
+        for (int idx = 0; idx + 1 < D; ++idx) gaps[idx] = image[idx + 1] - image[idx];
+        gaps[D - 1] = image[0] + N - image[D - 1];
+
+        for (int idx = 0; idx < D; ++idx) out[idx] = gaps[idx];
+        for (int start = 1; start < D; ++start) {
+            int cmp = 0;
+            for (int idx = 0; idx < D && cmp == 0; ++idx) cmp = gaps[(start + idx) % D] - out[idx];
+            if (cmp > 0) {
+                for (int idx = 0; idx < D; ++idx) out[idx] = gaps[(start + idx) % D];
+            }
+        }
+    }
+
+    // Whether probe x misses the arc (from, to) for every x in (last, N);
+    // walks whichever of the two is shorter
+    bool Empty(int from, int to, int last) const {
+        if (to - from < N - last) {
+            for (int y = from + 1; y < to; ++y) {
+                if (y % N * inverse % N > last) return false;
+            }
+        } else {
+            for (int x = last + 1; x < N; ++x) {
+                if ((x * probe % N - from + N) % N < to - from) return false;
+            }
+        }
+        return true;
+    }
+
+  public:
+    void init(int n, int d) {
+        N = n;
+        D = d;
+        units.clear();
+        for (int k = 2; k < N; ++k) {
+            if (gcd(k, N) == 1) units.push_back(k);
+        }
+        probe = units.front();  // N - 1 is always one
+        inverse = 1;
+        while (inverse * probe % N != 1) ++inverse;
+    }
+
+    // Whether no cover with the elements a[0..t] and D - 1 - t more in
+    // (a[t], N) leads its orbit
+    bool beaten(const int *a, int t) {
+        int widest = N - a[t] - (D - 1 - t);
+        for (int idx = 0; idx < t; ++idx) widest = std::max(widest, a[idx + 1] - a[idx]);
+        // the t + 1 + N - a[t] - 1 possible images leave no wider gap
+        if (a[t] - t + 1 <= widest) return false;
+        for (int idx = 0; idx <= t; ++idx) {
+            const int y = a[idx] * probe % N;
+            int pos = idx;
+            for (; pos > 0 && image[pos - 1] > y; --pos) image[pos] = image[pos - 1];
+            image[pos] = y;
+        }
+        for (int idx = 0; idx <= t; ++idx) {
+            const int from = image[idx];
+            const int to = idx < t ? image[idx + 1] : image[0] + N;
+            if (to - from > widest && Empty(from, to, a[t])) return true;
+        }
+        return false;
+    }
+
+    // Whether the class of the D residues set[0..D-1] leads its orbit
+    bool leader(const int *set) {
+        std::copy(set, set + D, image);
+        Canonical(own);
+        for (size_t u = 0; u < units.size(); ++u) {
+            const int k = units[u];
+            for (int idx = 0; idx < D; ++idx) image[idx] = set[idx] * k % N;
+            Canonical(other);
+            if (std::lexicographical_compare(own, own + D, other, other + D)) return false;
+        }
+        return true;
+    }
+};
+
+#endif
@@ -0,0 +1,145 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <cstring>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Hardware counters of the calling thread, read through perf_event_open.
+//
+// Each thread opens its own counters the first time it asks for them
+// (PerfCounters::thread()), counting user-space events of that thread only,
+// so the difference of two read()s around a task is the cost of that task no
+// matter what the other workers do.  Every event is opened on its own and
+// scaled by its enabled/running times if the kernel multiplexes it.  An
+// event the kernel or the CPU does not offer (in most VMs none of the
+// hardware ones), or every event off Linux, reads as -1.
+
+enum PerfEvent {
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_BRANCH_MISSES,
+    PERF_L1D_MISSES,
+    PERF_TASK_CLOCK,
+    NUM_PERF_EVENTS
+};
+static const char *const perf_names[NUM_PERF_EVENTS] = {"cycles", "instructions", "branch-misses",
+                                                        "L1D-misses", "task-clock-ns"};
+
+struct PerfSample {
+    long long value[NUM_PERF_EVENTS];  // -1 if unavailable
+
+    PerfSample() {
+        for (int idx = 0; idx < NUM_PERF_EVENTS; ++idx) value[idx] = 0;
+    }
+
+    void add(const PerfSample &other) {
+        for (int idx = 0; idx < NUM_PERF_EVENTS; ++idx) {
+            if (value[idx] < 0 || other.value[idx] < 0) {
+                value[idx] = -1;
+            } else {
+                value[idx] += other.value[idx];
+            }
+        }
+    }
+
+    // this - earlier, for two reads of the same thread
+    PerfSample since(const PerfSample &earlier) const {
+        PerfSample delta;
+        for (int idx = 0; idx < NUM_PERF_EVENTS; ++idx) {
+            delta.value[idx] =
+                value[idx] < 0 || earlier.value[idx] < 0 ? -1 : value[idx] - earlier.value[idx];
+        }
+        return delta;
+    }
+};
+
+class PerfCounters {
+  private:
+    int fd[NUM_PERF_EVENTS];
+
+#if defined(__linux__)
+    static int open_event(PerfEvent event) {
+        struct perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        switch (event) {
+            case PERF_CYCLES:
+                attr.config = PERF_COUNT_HW_CPU_CYCLES;
+                break;
+            case PERF_INSTRUCTIONS:
+                attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+                break;
+            case PERF_BRANCH_MISSES:
+                attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+                break;
+            case PERF_L1D_MISSES:
+                attr.type = PERF_TYPE_HW_CACHE;
+                attr.config = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                              | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+                break;
+            default:
+                attr.type = PERF_TYPE_SOFTWARE;
+                attr.config = PERF_COUNT_SW_TASK_CLOCK;
+                break;
+        }
+        // this thread, any CPU
+        return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+    }
+#endif
+
+  public:
+    PerfCounters() {
+        for (int idx = 0; idx < NUM_PERF_EVENTS; ++idx) {
+#if defined(__linux__)
+            fd[idx] = open_event(static_cast<PerfEvent>(idx));
+#else
+            fd[idx] = -1;
+#endif
+        }
+    }
+
+    ~PerfCounters() {
+#if defined(__linux__)
+        for (int idx = 0; idx < NUM_PERF_EVENTS; ++idx) {
+            if (fd[idx] >= 0) close(fd[idx]);
+        }
+#endif
+    }
+
+    PerfCounters(const PerfCounters &) = delete;
+    PerfCounters &operator=(const PerfCounters &) = delete;
+
+    // The counters of the calling thread, opened on first use
+    static PerfCounters &thread() {
+        static thread_local PerfCounters counters;
+        return counters;
+    }
+
+    PerfSample read() const {
+        PerfSample sample;
+        for (int idx = 0; idx < NUM_PERF_EVENTS; ++idx) {
+            sample.value[idx] = -1;
+#if defined(__linux__)
+            unsigned long long data[3];  // value, time enabled, time running
+            if (fd[idx] < 0 || ::read(fd[idx], data, sizeof(data)) != sizeof(data)) continue;
+            if (data[2] != 0 && data[2] < data[1]) {
+                data[0] = static_cast<unsigned long long>(static_cast<double>(data[0]) * data[1]
+                                                          / data[2]);
+            }
+            sample.value[idx] = static_cast<long long>(data[0]);
+#endif
+        }
+        return sample;
+    }
+};
+
+#endif
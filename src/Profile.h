@@ -0,0 +1,143 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Per-depth profiles of the search trees.
+//
+// A generator takes a profiling policy as a template parameter (usually as
+// an empty base) and calls enter(t) for every node it opens at depth t,
+// prune(t) when a bound cuts that node and leaf(t) for every complete set
+// it reaches; finish() ends a task.  NoProfile does nothing, so the default
+// instantiations compile to the code they had without profiling.
+// DepthProfile counts into arrays owned by the generator, which a single
+// thread runs, and adds the counts of each finished task to the
+// process-wide ProfileLog, which main() writes out at exit.
+
+struct NoProfile {
+    static constexpr bool enabled = false;
+    void enter(int /* t */) {}
+    void prune(int /* t */) {}
+    void leaf(int /* t */) {}
+    void finish(const int * /* prefix */, int /* len */) {}
+};
+
+// Counters of all tasks, one row per task and depth
+class ProfileLog {
+  public:
+    struct Row {
+        std::string task;  // the task's prefix, e.g. "36-30-25"
+        int depth;
+        long long entered;
+        long long pruned;
+        long long leaves;
+    };
+
+    static ProfileLog &global() {
+        static ProfileLog log;
+        return log;
+    }
+
+    void add(const std::vector<Row> &task) {
+        std::unique_lock<std::mutex> lock(mutex);
+        rows.insert(rows.end(), task.begin(), task.end());
+    }
+
+    // Writes CSV, or JSON if the path ends in .json, with the rows of every
+    // task followed by the totals per depth under the task name "all"
+    bool dump(const char *path) const {
+        std::unique_lock<std::mutex> lock(mutex);
+        std::vector<Row> all;
+        for (size_t idx = 0; idx < rows.size(); ++idx) {
+            const Row &row = rows[idx];
+            if (static_cast<int>(all.size()) <= row.depth) {
+                for (int depth = all.size(); depth <= row.depth; ++depth) {
+                    all.push_back(Row{"all", depth, 0, 0, 0});
+                }
+            }
+            all[row.depth].entered += row.entered;
+            all[row.depth].pruned += row.pruned;
+            all[row.depth].leaves += row.leaves;
+        }
+
+        FILE *file = fopen(path, "w");
+        if (file == nullptr) return false;
+        const size_t len = strlen(path);
+        const bool json = len >= 5 && strcmp(path + len - 5, ".json") == 0;
+        if (json) {
+            fprintf(file, "[\n");
+        } else {
+            fprintf(file, "task,depth,entered,pruned,leaves\n");
+        }
+        const std::vector<Row> *parts[2] = {&rows, &all};
+        bool first = true;
+        for (int part = 0; part < 2; ++part) {
+            for (size_t idx = 0; idx < parts[part]->size(); ++idx) {
+                const Row &row = (*parts[part])[idx];
+                if (row.entered == 0 && row.leaves == 0) continue;
+                if (json) {
+                    fprintf(file,
+                            "%s  {\"task\": \"%s\", \"depth\": %d, \"entered\": %lld, "
+                            "\"pruned\": %lld, \"leaves\": %lld}",
+                            first ? "" : ",\n", row.task.c_str(), row.depth, row.entered,
+                            row.pruned, row.leaves);
+                } else {
+                    fprintf(file, "%s,%d,%lld,%lld,%lld\n", row.task.c_str(), row.depth,
+                            row.entered, row.pruned, row.leaves);
+                }
+                first = false;
+            }
+        }
+        if (json) fprintf(file, "\n]\n");
+        return fclose(file) == 0;
+    }
+
+  private:
+    mutable std::mutex mutex;
+    std::vector<Row> rows;
+};
+
+// Counts per depth 0..MaxDepth
+template <int MaxDepth>
+class DepthProfile {
+  private:
+    long long entered[MaxDepth + 1];
+    long long pruned[MaxDepth + 1];
+    long long leaves[MaxDepth + 1];
+
+  public:
+    static constexpr bool enabled = true;
+
+    DepthProfile() {
+        std::memset(entered, 0, sizeof(entered));
+        std::memset(pruned, 0, sizeof(pruned));
+        std::memset(leaves, 0, sizeof(leaves));
+    }
+
+    void enter(int t) { ++entered[t]; }
+    void prune(int t) { ++pruned[t]; }
+    void leaf(int t) { ++leaves[t]; }
+
+    // Logs the counts under the task's prefix and starts over
+    void finish(const int *prefix, int len) {
+        std::string task;
+        for (int idx = 0; idx < len; ++idx) {
+            if (idx > 0) task += "-";
+            task += std::to_string(prefix[idx]);
+        }
+        std::vector<ProfileLog::Row> rows;
+        for (int depth = 0; depth <= MaxDepth; ++depth) {
+            if (entered[depth] == 0 && leaves[depth] == 0) continue;
+            rows.push_back(
+                ProfileLog::Row{task, depth, entered[depth], pruned[depth], leaves[depth]});
+        }
+        ProfileLog::global().add(rows);
+        *this = DepthProfile();
+    }
+};
+
+#endif
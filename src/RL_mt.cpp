@@ -81,13 +81,14 @@ This approach combines the power of artificial intelligence with parallel comput
 #include <mutex>
 #include <atomic>
 
+#include "Topology.h"
+
 // Neural Network Constants
 constexpr int HIDDEN_SIZE1 = 256;  // Number of neurons in first hidden layer
 constexpr int HIDDEN_SIZE2 = 128;  // Number of neurons in second hidden layer
 constexpr float LEARNING_RATE = 0.01;  // Learning rate for gradient descent
 constexpr float GAMMA = 0.98;  // Discount factor for future rewards
 constexpr int MAX_EPISODES = 1000000000;  // Maximum training episodes
-constexpr int NUM_THREADS = 10;  // Number of threads to use for parallel training
 
 // Policy Network class implements a neural network for reinforcement learning
 class PolicyNetwork {
@@ -363,12 +364,16 @@ void findDifferenceCoverRL(int N, int D) {
     std::atomic<bool> solutionFound(false);  // Flag when solution is found
     std::mutex outputMutex;  // Mutex for synchronized output
 
-    // Create and launch worker threads
+    // Create and launch one worker thread per core we may use (see Topology.h)
+    const Topology& topology = Topology::get();
+    const int numThreads = static_cast<int>(topology.workers());
+    const bool pin = topology.pinnable(numThreads);
     std::vector<std::thread> threads;
-    for (int idx = 0; idx < NUM_THREADS; ++idx) {
-        threads.emplace_back(workerThread, std::ref(policyNet), N, D,
-                           std::ref(episodeCounter), std::ref(solutionFound),
-                           std::ref(outputMutex));
+    for (int idx = 0; idx < numThreads; ++idx) {
+        threads.emplace_back([&, idx]() {
+            if (pin) topology.pin(idx);
+            workerThread(policyNet, N, D, episodeCounter, solutionFound, outputMutex);
+        });
     }
 
     // Wait for all threads to complete
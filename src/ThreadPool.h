@@ -1,7 +1,9 @@
 #ifndef THREAD_POOL_H
 #define THREAD_POOL_H
 
+#include <atomic>
 #include <condition_variable>
+#include <cstdint>
 #include <functional>
 #include <future>
 #include <memory>
@@ -11,51 +13,291 @@
 #include <thread>
 #include <vector>
 
+#include "Topology.h"
+
+// Work-stealing thread pool.
+//
+// Every worker owns a Chase-Lev deque: tasks a worker enqueues (the prefixes
+// a running search donates) go to the bottom of its own deque and it takes
+// them back from there without a lock, while idle workers steal from the
+// top of a random victim's deque.  Tasks enqueued from other threads (the
+// drivers' initial tasks) go through one locked queue `injected`, which
+// keeps their order unless they were given a Priority.  A worker that finds
+// nothing anywhere sleeps on a condition variable.  `epoch` counts enqueues,
+// so a worker only goes to sleep if no task arrived since it started
+// looking, and enqueue() only takes the lock to wake a worker if one is
+// asleep.
+
+// Chase-Lev deque of task pointers (Le, Pop, Cohen and Zappa Nardelli, "Correct
+// and Efficient Work-Stealing for Weak Memory Models", PPoPP 2013).  Only the
+// owner calls push() and pop(); any thread may call steal().  Arrays
+// outgrown by push() stay allocated until the deque is destroyed, since a
+// thief may still be reading one.
+template <class T>
+class WorkDeque {
+  private:
+    struct Array {
+        const int64_t size;  // a power of two
+        std::unique_ptr<std::atomic<T *>[]> slots;
+
+        explicit Array(int64_t size) : size(size), slots(new std::atomic<T *>[size]) {}
+        T *get(int64_t idx) const {
+            return slots[idx & (size - 1)].load(std::memory_order_relaxed);
+        }
+        void put(int64_t idx, T *item) {
+            slots[idx & (size - 1)].store(item, std::memory_order_relaxed);
+        }
+    };
+
+    std::atomic<int64_t> top;
+    std::atomic<int64_t> bottom;
+    std::atomic<Array *> array;
+    std::vector<std::unique_ptr<Array>> arrays;  // owner only
+
+  public:
+    WorkDeque() : top(0), bottom(0) {
+        arrays.emplace_back(new Array(64));
+        array.store(arrays.back().get(), std::memory_order_relaxed);
+    }
+
+    void push(T *item) {
+        const int64_t b = bottom.load(std::memory_order_relaxed);
+        const int64_t t = top.load(std::memory_order_acquire);
+        Array *a = array.load(std::memory_order_relaxed);
+        if (b - t > a->size - 1) {
+            arrays.emplace_back(new Array(2 * a->size));
+            Array *grown = arrays.back().get();
+            for (int64_t idx = t; idx < b; ++idx) grown->put(idx, a->get(idx));
+            array.store(grown, std::memory_order_release);
+            a = grown;
+        }
+        a->put(b, item);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom.store(b + 1, std::memory_order_relaxed);
+    }
+
+    T *pop() {
+        const int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        Array *a = array.load(std::memory_order_relaxed);
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top.load(std::memory_order_relaxed);
+        if (t > b) {
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        T *item = a->get(b);
+        if (t == b) {
+            // the last item: race the thieves for it
+            if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                             std::memory_order_relaxed)) {
+                item = nullptr;
+            }
+            bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return item;
+    }
+
+    T *steal() {
+        int64_t t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const int64_t b = bottom.load(std::memory_order_acquire);
+        if (t >= b) return nullptr;
+        Array *a = array.load(std::memory_order_acquire);
+        T *item = a->get(t);
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                         std::memory_order_relaxed)) {
+            return nullptr;
+        }
+        return item;
+    }
+
+    bool empty() const {
+        return bottom.load(std::memory_order_relaxed) <= top.load(std::memory_order_relaxed);
+    }
+};
+
+// Start priority of a task: of the tasks waiting in the shared queue the
+// one with the highest priority starts first, ties in enqueue order.
+// Tasks enqueued without one have priority 0.
+struct Priority {
+    double value;
+    explicit Priority(double value) : value(value) {}
+};
+
 class ThreadPool {
   public:
-    ThreadPool(size_t);
+    // One worker per core the process may use (see Topology.h), pinned if
+    // that covers every core
+    ThreadPool();
+    ThreadPool(size_t threads, bool pin = false);
     template <class F, class... Args>
     auto enqueue(F &&f, Args &&...args)
 #if __cplusplus >= 201703L
         -> std::future<typename std::invoke_result<F, Args...>::type>;
 #else
         -> std::future<typename std::result_of<F(Args...)>::type>;
+#endif
+    // Prioritized tasks always go through the shared queue, also when a
+    // worker enqueues them
+    template <class F, class... Args>
+    auto enqueue(Priority priority, F &&f, Args &&...args)
+#if __cplusplus >= 201703L
+        -> std::future<typename std::invoke_result<F, Args...>::type>;
+#else
+        -> std::future<typename std::result_of<F(Args...)>::type>;
 #endif
     ~ThreadPool();
 
+    size_t size() const { return workers.size(); }
+
+    // number of workers that would still be idle once the queued tasks are
+    // taken; a cheap hint for producers that split work on demand
+    int idle() const {
+        return idle_workers.load(std::memory_order_relaxed)
+               - queued.load(std::memory_order_relaxed);
+    }
+
   private:
+    typedef std::function<void()> Task;
+
+    struct Worker {
+        WorkDeque<Task> deque;
+        uint64_t seed;  // xorshift state for picking victims
+    };
+
+    struct Injected {
+        double priority;
+        uint64_t seq;
+        Task *task;
+
+        // priority_queue pops the largest: highest priority, then oldest
+        bool operator<(const Injected &other) const {
+            return priority < other.priority || (priority == other.priority && seq > other.seq);
+        }
+    };
+
     // need to keep track of threads so we can join them
     std::vector<std::thread> workers;
-    // the task queue
-    std::queue<std::function<void()>> tasks;
+    std::vector<std::unique_ptr<Worker>> locals;
 
-    // synchronization
+    // tasks from threads outside the pool and prioritized tasks
     std::mutex queue_mutex;
+    std::priority_queue<Injected> injected;
+    uint64_t injected_seq;  // guarded by queue_mutex
+    std::atomic<int> num_injected;
+
+    // sleeping
     std::condition_variable condition;
-    bool stop;
+    std::atomic<uint64_t> epoch;  // bumped by every enqueue
+    std::atomic<int> sleepers;
+    std::atomic<bool> stop;
+
+    std::atomic<int> idle_workers;  // workers not running a task
+    std::atomic<int> queued;        // tasks enqueued and not yet taken
+
+    // the pool and worker index of the calling thread, if it is a worker
+    static ThreadPool *&current_pool() {
+        static thread_local ThreadPool *pool = nullptr;
+        return pool;
+    }
+    static size_t &current_index() {
+        static thread_local size_t index = 0;
+        return index;
+    }
+
+    Task *take(size_t self);
+    void run(size_t self);
+    void push(Task *item, bool shared, double priority);
 };
 
+inline ThreadPool::ThreadPool()
+    : ThreadPool(Topology::get().workers(), Topology::get().pinnable(Topology::get().workers())) {}
+
 // the constructor just launches some amount of workers
-inline ThreadPool::ThreadPool(size_t threads) : stop(false) {
-    for (size_t i = 0; i < threads; ++i)
-        workers.emplace_back([this] {
-            for (;;) {
-                std::function<void()> task;
-
-                {
-                    std::unique_lock<std::mutex> lock(this->queue_mutex);
-                    this->condition.wait(lock, [this] {
-                        return this->stop || !this->tasks.empty();
-                    });
-                    if (this->stop && this->tasks.empty())
-                        return;
-                    task = std::move(this->tasks.front());
-                    this->tasks.pop();
-                }
-
-                task();
-            }
+inline ThreadPool::ThreadPool(size_t threads, bool pin)
+    : injected_seq(0),
+      num_injected(0),
+      epoch(0),
+      sleepers(0),
+      stop(false),
+      idle_workers(int(threads)),
+      queued(0) {
+    for (size_t i = 0; i < threads; ++i) {
+        locals.emplace_back(new Worker());
+        locals.back()->seed = 0x9E3779B97F4A7C15ull * (i + 1);
+    }
+    for (size_t i = 0; i < threads; ++i) {
+        workers.emplace_back([this, i, pin] {
+            if (pin) Topology::get().pin(i);
+            run(i);
         });
+    }
+}
+
+// Own deque first, then the injected FIFO, then one round of steals
+// starting at a random victim
+inline ThreadPool::Task *ThreadPool::take(size_t self) {
+    Worker &local = *locals[self];
+    if (Task *task = local.deque.pop()) return task;
+    if (num_injected.load(std::memory_order_acquire) > 0) {
+        std::unique_lock<std::mutex> lock(queue_mutex);
+        if (!injected.empty()) {
+            Task *task = injected.top().task;
+            injected.pop();
+            num_injected.fetch_sub(1, std::memory_order_relaxed);
+            return task;
+        }
+    }
+    const size_t num = locals.size();
+    uint64_t &x = local.seed;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    const size_t start = size_t(x % num);
+    for (size_t k = 0; k < num; ++k) {
+        const size_t victim = (start + k) % num;
+        if (victim == self) continue;
+        if (Task *task = locals[victim]->deque.steal()) return task;
+    }
+    return nullptr;
+}
+
+inline void ThreadPool::run(size_t self) {
+    current_pool() = this;
+    current_index() = self;
+    for (;;) {
+        const uint64_t seen = epoch.load(std::memory_order_seq_cst);
+        Task *task = take(self);
+        if (task == nullptr) {
+            // a steal can fail against a racing thief; look once more
+            std::this_thread::yield();
+            task = take(self);
+        }
+        if (task == nullptr && stop.load(std::memory_order_acquire)) {
+            // draining: leave once no task is left to take
+            if (queued.load(std::memory_order_acquire) == 0) return;
+            std::this_thread::yield();
+            continue;
+        }
+        if (task == nullptr) {
+            std::unique_lock<std::mutex> lock(queue_mutex);
+            sleepers.fetch_add(1, std::memory_order_seq_cst);
+            // nothing was enqueued since `seen`, so every queue was empty
+            // when take() looked; an enqueue after this check sees us asleep
+            while (epoch.load(std::memory_order_seq_cst) == seen
+                   && !stop.load(std::memory_order_relaxed)) {
+                condition.wait(lock);
+            }
+            sleepers.fetch_sub(1, std::memory_order_relaxed);
+            continue;
+        }
+        idle_workers.fetch_sub(1, std::memory_order_relaxed);
+        queued.fetch_sub(1, std::memory_order_release);
+        (*task)();
+        delete task;
+        idle_workers.fetch_add(1, std::memory_order_relaxed);
+    }
 }
 
 // add new work item to the pool
@@ -77,24 +319,62 @@ auto ThreadPool::enqueue(F &&f, Args &&...args)
         std::bind(std::forward<F>(f), std::forward<Args>(args)...));
 
     std::future<return_type> res = task->get_future();
-    {
-        std::unique_lock<std::mutex> lock(queue_mutex);
+    push(new Task([task]() { (*task)(); }), false, 0);
+    return res;
+}
 
-        // don't allow enqueueing after stopping the pool
-        if (stop)
-            throw std::runtime_error("enqueue on stopped ThreadPool");
+template <class F, class... Args>
+auto ThreadPool::enqueue(Priority priority, F &&f, Args &&...args)
+#if __cplusplus >= 201703L
+    -> std::future<typename std::invoke_result<F, Args...>::type>
+#else
+    -> std::future<typename std::result_of<F(Args...)>::type>
+#endif
+{
+#if __cplusplus >= 201703L
+    using return_type = typename std::invoke_result<F, Args...>::type;
+#else
+    using return_type = typename std::result_of<F(Args...)>::type;
+#endif
 
-        tasks.emplace([task]() { (*task)(); });
-    }
-    condition.notify_one();
+    auto task = std::make_shared<std::packaged_task<return_type()>>(
+        std::bind(std::forward<F>(f), std::forward<Args>(args)...));
+
+    std::future<return_type> res = task->get_future();
+    push(new Task([task]() { (*task)(); }), true, priority.value);
     return res;
 }
 
-// the destructor joins all threads
+// Queues a wrapped task on the caller's deque if it is a worker of this
+// pool, else (or if `shared`) on the shared queue, and wakes a sleeper
+inline void ThreadPool::push(Task *item, bool shared, double priority) {
+    // don't allow enqueueing after stopping the pool
+    if (stop.load(std::memory_order_relaxed)) {
+        delete item;
+        throw std::runtime_error("enqueue on stopped ThreadPool");
+    }
+
+    queued.fetch_add(1, std::memory_order_relaxed);
+    if (!shared && current_pool() == this) {
+        locals[current_index()]->deque.push(item);
+    } else {
+        std::unique_lock<std::mutex> lock(queue_mutex);
+        injected.push(Injected{priority, injected_seq++, item});
+        num_injected.fetch_add(1, std::memory_order_release);
+    }
+    epoch.fetch_add(1, std::memory_order_seq_cst);
+    if (sleepers.load(std::memory_order_seq_cst) > 0) {
+        std::unique_lock<std::mutex> lock(queue_mutex);
+        condition.notify_one();
+    }
+}
+
+// the destructor lets the workers drain the queues and joins them
 inline ThreadPool::~ThreadPool() {
     {
         std::unique_lock<std::mutex> lock(queue_mutex);
         stop = true;
+        epoch.fetch_add(1, std::memory_order_seq_cst);
     }
     condition.notify_all();
     for (std::thread &worker : workers)
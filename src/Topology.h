@@ -0,0 +1,225 @@
+#ifndef TOPOLOGY_H
+#define TOPOLOGY_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#if defined(__linux__)
+#include <dirent.h>
+#include <sched.h>
+#endif
+
+// The CPUs this process may run on and how they are laid out, for sizing
+// and pinning worker pools.
+//
+// The allowed CPUs are the affinity mask, which taskset or a cpuset cgroup
+// narrows.  The quota comes from the CPU controller of the process's cgroup
+// and of its ancestors, the smallest one wins: cpu.max under cgroup v2,
+// cpu.cfs_quota_us / cpu.cfs_period_us under v1.  Cores and NUMA nodes come
+// from /sys/devices/system/cpu.
+//
+// The searches keep every execution unit of a core busy, so a second SMT
+// sibling adds little, and a pool wider than the quota is throttled at every
+// period.  workers() is therefore the number of physical cores among the
+// allowed CPUs, capped at the quota rounded up, and at least 1.  Workers
+// take the cores of one NUMA node before the next, one sibling per core
+// first.  Pinning only pays off when the pool owns the machine: with a pool
+// narrower than the allowed cores another process pinned the same way would
+// share its first cores while the rest idle, so pinnable() is false then.
+// Off Linux everything falls back to hardware_concurrency().
+class Topology {
+  private:
+    std::vector<int> order;  // allowed CPUs in the order workers take them
+    int num_cores;           // physical cores among the allowed CPUs
+    double quota;            // CPUs the cgroup grants, 0 if unlimited
+
+#if defined(__linux__)
+    static bool read_line(const std::string &path, std::string &line) {
+        FILE *file = fopen(path.c_str(), "r");
+        if (file == nullptr) return false;
+        char buf[256];
+        const bool ok = fgets(buf, sizeof(buf), file) != nullptr;
+        fclose(file);
+        if (ok) line = buf;
+        return ok;
+    }
+
+    static int read_int(const std::string &path, int fallback) {
+        std::string line;
+        return read_line(path, line) ? atoi(line.c_str()) : fallback;
+    }
+
+    // The NUMA node a CPU belongs to, from its nodeN link
+    static int node_of(int cpu) {
+        const std::string path = "/sys/devices/system/cpu/cpu" + std::to_string(cpu);
+        DIR *dir = opendir(path.c_str());
+        if (dir == nullptr) return 0;
+        int node = 0;
+        while (struct dirent *entry = readdir(dir)) {
+            if (strncmp(entry->d_name, "node", 4) == 0 && entry->d_name[4] >= '0'
+                && entry->d_name[4] <= '9') {
+                node = atoi(entry->d_name + 4);
+                break;
+            }
+        }
+        closedir(dir);
+        return node;
+    }
+
+    // CPUs granted by the quota of cgroup `path` under the v2 or v1 mount
+    // `root`, or 0 if it has none
+    static double limit_of(const std::string &root, const std::string &path, bool v2) {
+        std::string line;
+        if (v2) {
+            if (!read_line(root + path + "/cpu.max", line) || line.compare(0, 3, "max") == 0) {
+                return 0;
+            }
+            double max = 0;
+            double period = 0;
+            return sscanf(line.c_str(), "%lf %lf", &max, &period) == 2 && period > 0
+                       ? max / period
+                       : 0;
+        }
+        const int max = read_int(root + path + "/cpu.cfs_quota_us", -1);
+        const int period = read_int(root + path + "/cpu.cfs_period_us", 0);
+        return max > 0 && period > 0 ? static_cast<double>(max) / period : 0;
+    }
+
+    // The smallest quota on the way from the process's cgroup to the root.
+    // Inside a container the cgroup namespace shows the container's cgroup
+    // as "/", so its own limit is the one at the mount point.
+    static double read_quota() {
+        FILE *file = fopen("/proc/self/cgroup", "r");
+        if (file == nullptr) return 0;
+        std::string path;
+        std::string root;
+        bool v2 = false;
+        char buf[4096];
+        while (fgets(buf, sizeof(buf), file) != nullptr) {
+            // hierarchy-id:controllers:path
+            std::string line(buf);
+            if (!line.empty() && line[line.size() - 1] == '\n') line.erase(line.size() - 1);
+            const size_t first = line.find(':');
+            const size_t second = line.find(':', first + 1);
+            if (first == std::string::npos || second == std::string::npos) continue;
+            const std::string controllers = line.substr(first + 1, second - first - 1);
+            if (controllers.empty()) {
+                if (root.empty()) {
+                    path = line.substr(second + 1);
+                    root = "/sys/fs/cgroup";
+                    v2 = true;
+                }
+            } else if ((',' + controllers + ',').find(",cpu,") != std::string::npos) {
+                path = line.substr(second + 1);
+                root = "/sys/fs/cgroup/" + controllers;
+                v2 = false;
+            }
+        }
+        fclose(file);
+        if (root.empty()) return 0;
+        double quota = 0;
+        for (;;) {
+            const double limit = limit_of(root, path == "/" ? "" : path, v2);
+            if (limit > 0 && (quota == 0 || limit < quota)) quota = limit;
+            if (path.empty() || path == "/") break;
+            path.erase(path.rfind('/'));
+        }
+        return quota;
+    }
+
+    Topology() : num_cores(0), quota(0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if (sched_getaffinity(0, sizeof(set), &set) != 0) {
+            fallback();
+            return;
+        }
+        // (node, package, core, cpu) of every allowed CPU
+        std::vector<std::tuple<int, int, int, int>> cpus;
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (!CPU_ISSET(cpu, &set)) continue;
+            const std::string base =
+                "/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/";
+            cpus.push_back(std::make_tuple(node_of(cpu), read_int(base + "physical_package_id", 0),
+                                           read_int(base + "core_id", cpu), cpu));
+        }
+        if (cpus.empty()) {
+            fallback();
+            return;
+        }
+        std::sort(cpus.begin(), cpus.end());
+        // siblings are adjacent now; workers take the first sibling of every
+        // core, then the second ones, and so on
+        std::vector<std::vector<int>> cores;
+        for (size_t idx = 0; idx < cpus.size(); ++idx) {
+            if (idx == 0 || std::get<0>(cpus[idx]) != std::get<0>(cpus[idx - 1])
+                || std::get<1>(cpus[idx]) != std::get<1>(cpus[idx - 1])
+                || std::get<2>(cpus[idx]) != std::get<2>(cpus[idx - 1])) {
+                cores.push_back(std::vector<int>());
+            }
+            cores.back().push_back(std::get<3>(cpus[idx]));
+        }
+        num_cores = static_cast<int>(cores.size());
+        for (size_t round = 0; order.size() < cpus.size(); ++round) {
+            for (size_t idx = 0; idx < cores.size(); ++idx) {
+                if (round < cores[idx].size()) order.push_back(cores[idx][round]);
+            }
+        }
+        quota = read_quota();
+    }
+#else
+    Topology() : num_cores(0), quota(0) { fallback(); }
+#endif
+
+    void fallback() {
+        const int num = std::max(1u, std::thread::hardware_concurrency());
+        order.clear();
+        for (int cpu = 0; cpu < num; ++cpu) order.push_back(cpu);
+        num_cores = num;
+        quota = 0;
+    }
+
+  public:
+    static const Topology &get() {
+        static const Topology topology;
+        return topology;
+    }
+
+    int cpus() const { return static_cast<int>(order.size()); }
+    int cores() const { return num_cores; }
+    double cpu_quota() const { return quota; }
+
+    // Workers for a compute-bound pool
+    unsigned workers() const {
+        int num = num_cores;
+        if (quota > 0) num = std::min(num, static_cast<int>(std::ceil(quota)));
+        return static_cast<unsigned>(std::max(num, 1));
+    }
+
+    // Whether a pool of `num` workers should be pinned
+    bool pinnable(unsigned num) const {
+        return static_cast<int>(num) == num_cores && order.size() > 1;
+    }
+
+    // Binds the calling thread to the CPU of worker `idx`
+    bool pin(size_t idx) const {
+#if defined(__linux__)
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(order[idx % order.size()], &set);
+        return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+        (void)idx;
+        return false;
+#endif
+    }
+};
+
+#endif
@@ -0,0 +1,175 @@
+#ifndef WORK_DIR_H
+#define WORK_DIR_H
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <utime.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <string>
+#include <vector>
+
+// A work directory shared by one coordinator and any number of worker
+// processes, on one host or on hosts that mount the same filesystem.  Tasks
+// are small text files and every state change is a rename or a link, which
+// are atomic on POSIX filesystems (NFS included), so no process needs a lock
+// or a connection to another one:
+//
+//   job                      run parameters, written once by the coordinator
+//   todo/<task>              tasks nobody holds
+//   leased/<task>.<worker>   a task claimed by renaming it out of todo/; the
+//                            worker renews the lease by touching the file
+//   results/<task>           the output of a finished task
+//
+// A worker writes its output to results/<task>.<worker>.tmp and publishes it
+// with link(), which fails if another worker already published the task, so
+// each task is reported exactly once even after its lease was reissued.  The
+// coordinator moves leases whose file has not changed for `lease` seconds
+// back to todo/.  Expiry is measured on the coordinator's clock, so workers
+// on hosts with a skewed clock are not expired early.
+class WorkDir {
+  private:
+    std::string root;
+    std::string worker;  // <host>.<pid>
+    // mtime of each lease when first seen unchanged, and when that was
+    std::map<std::string, std::pair<time_t, std::chrono::steady_clock::time_point>> seen;
+
+    std::string at(const std::string &name) const { return root + "/" + name; }
+
+    static bool make_dir(const std::string &path) {
+        return mkdir(path.c_str(), 0777) == 0 || errno == EEXIST;
+    }
+
+  public:
+    explicit WorkDir(const std::string &root) : root(root) {
+        char host[256] = "localhost";
+        gethostname(host, sizeof(host) - 1);
+        worker = std::string(host) + "." + std::to_string(static_cast<long long>(getpid()));
+    }
+
+    bool create() const {
+        return make_dir(root) && make_dir(at("todo")) && make_dir(at("leased"))
+               && make_dir(at("results"));
+    }
+
+    // Writes a file atomically: readers see the old contents or all of `body`
+    bool put(const std::string &name, const std::string &body) const {
+        const std::string tmp = at(name) + "." + worker + ".tmp";
+        FILE *file = fopen(tmp.c_str(), "w");
+        if (file == nullptr) return false;
+        bool ok = fwrite(body.data(), 1, body.size(), file) == body.size() && fflush(file) == 0
+                  && fsync(fileno(file)) == 0;
+        ok = fclose(file) == 0 && ok;
+        return ok && rename(tmp.c_str(), at(name).c_str()) == 0;
+    }
+
+    bool get(const std::string &name, std::string &body) const {
+        FILE *file = fopen(at(name).c_str(), "r");
+        if (file == nullptr) return false;
+        body.clear();
+        char buf[4096];
+        for (size_t len; (len = fread(buf, 1, sizeof(buf), file)) > 0;) body.append(buf, len);
+        fclose(file);
+        return true;
+    }
+
+    bool exists(const std::string &name) const {
+        struct stat st;
+        return stat(at(name).c_str(), &st) == 0;
+    }
+
+    // Names in a subdirectory, skipping the temporaries of put() and open()
+    std::vector<std::string> list(const char *sub) const {
+        std::vector<std::string> names;
+        DIR *dir = opendir(at(sub).c_str());
+        if (dir == nullptr) return names;
+        while (struct dirent *entry = readdir(dir)) {
+            const std::string name = entry->d_name;
+            if (name[0] == '.') continue;
+            if (name.size() > 4 && name.compare(name.size() - 4, 4, ".tmp") == 0) continue;
+            names.push_back(name);
+        }
+        closedir(dir);
+        return names;
+    }
+
+    // Worker side
+
+    // Claims some task from todo/ and reads it; false if none is left
+    bool claim(std::string &task, std::string &body) const {
+        const std::vector<std::string> todo = list("todo");
+        for (size_t idx = 0; idx < todo.size(); ++idx) {
+            const std::string lease = "leased/" + todo[idx] + "." + worker;
+            if (rename(at("todo/" + todo[idx]).c_str(), at(lease).c_str()) != 0) continue;
+            // lost the race against a finished copy of a reissued task
+            if (exists("results/" + todo[idx]) || !get(lease, body)) {
+                unlink(at(lease).c_str());
+                continue;
+            }
+            task = todo[idx];
+            return true;
+        }
+        return false;
+    }
+
+    // False once the lease was reissued; the result is still accepted
+    bool renew(const std::string &task) const {
+        return utime(at("leased/" + task + "." + worker).c_str(), nullptr) == 0;
+    }
+
+    FILE *open(const std::string &task) const {
+        return fopen(at("results/" + task + "." + worker + ".tmp").c_str(), "w");
+    }
+
+    // Publishes the output written to open(task), closing `file`, and
+    // releases the lease
+    bool publish(const std::string &task, FILE *file) const {
+        const std::string tmp = at("results/" + task + "." + worker + ".tmp");
+        bool ok = fflush(file) == 0 && fsync(fileno(file)) == 0;
+        ok = fclose(file) == 0 && ok;
+        ok = ok && (link(tmp.c_str(), at("results/" + task).c_str()) == 0 || errno == EEXIST);
+        unlink(tmp.c_str());
+        unlink(at("leased/" + task + "." + worker).c_str());
+        return ok;
+    }
+
+    // Coordinator side
+
+    // Returns expired and finished leases to todo/ or drops them; returns
+    // the number of leases reissued
+    int reissue(int lease) {
+        const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        const std::vector<std::string> leased = list("leased");
+        std::map<std::string, std::pair<time_t, std::chrono::steady_clock::time_point>> current;
+        int reissued = 0;
+        for (size_t idx = 0; idx < leased.size(); ++idx) {
+            const std::string &name = leased[idx];
+            const std::string task = name.substr(0, name.find('.'));
+            struct stat st;
+            if (stat(at("leased/" + name).c_str(), &st) != 0) continue;
+            if (exists("results/" + task)) {
+                unlink(at("leased/" + name).c_str());
+                continue;
+            }
+            auto it = seen.find(name);
+            if (it == seen.end() || it->second.first != st.st_mtime) {
+                current[name] = std::make_pair(st.st_mtime, now);
+            } else if (now - it->second.second >= std::chrono::seconds(lease)) {
+                if (rename(at("leased/" + name).c_str(), at("todo/" + task).c_str()) == 0) {
+                    ++reissued;
+                }
+            } else {
+                current[name] = it->second;
+            }
+        }
+        seen.swap(current);
+        return reissued;
+    }
+};
+
+#endif
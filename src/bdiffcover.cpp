@@ -6,8 +6,8 @@
 // #include <vector>
 #include <cstdio>
 
-static const int MAX = 20;
-static const int MAX_N = 160;
+#include "Capacity.h"
+
 static const int NECK = 1;
 static const int LYN = 0;
 static const int TRUE = 1;
@@ -24,15 +24,16 @@ struct element {
 //-------------------------------------------------------------
 // GLOBAL VARIABLES
 //-------------------------------------------------------------
+template <int MaxN>
 struct DiffCover {
-    element B[MAX_N];
-    cell avail[MAX_N];
+    element B[MaxN + 2];
+    cell avail[MaxN + 2];
     int nb = 0;
     // run length encoding data structure
     // number of blocks
     int num[3];
-    int a[MAX_N];
-    int run[MAX_N];
+    int a[MaxN + 2];
+    int run[MaxN + 2];
     int n;
     int k = 2;
     int total;
@@ -238,6 +239,16 @@ struct DiffCover {
     }
 };
 
+//------------------------------------------------------
+template <int MaxN>
+struct Run {
+    static void run(int num_elem, int density, int threshold) {
+        DiffCover<MaxN> dc(num_elem, density, threshold);
+        dc.Gen0();
+        printf("Total = %d\n", dc.total);
+    }
+};
+
 //------------------------------------------------------
 void usage() { printf("Usage: bdiffcover [num_elem] [density] [threshold]\n"); }
 //--------------------------------------------------------------------------------
@@ -271,7 +282,10 @@ int main(int argc, char **argv) {
     //     printf(" enter # of %d: ", j);
     //     scanf("%d", &num[j]);
     // }
-    DiffCover dc(num_elem, density, threshold);
-    dc.Gen0();
-    printf("Total = %d\n", dc.total);
+    // Arrays are indexed by string position only, so the class depends on N alone
+    if (!DispatchPositions<Run>(num_elem, num_elem, density, threshold)) {
+        printf("Error: N <= %d required\n", CAPACITY_MAX_N);
+        return 1;
+    }
+    return 0;
 }
@@ -17,6 +17,10 @@
 
  #include <stdio.h>
  #include <stdlib.h>
+ #include <string.h>
+
+ #include "Profile.h"
+
  #define MAX 20
 
  typedef struct cell {
@@ -27,7 +31,9 @@
      int s, v;
  } element;
 
- class NecklaceGenerator {
+ // Profile counts the nodes of GenBF per depth t (see Profile.h)
+ template <class Profile = NoProfile>
+ class NecklaceGenerator : private Profile {
  private:
      // Member variables (formerly global)
      int N, K, D, M, head;
@@ -126,6 +132,7 @@ public:
     void GenBF(int t, int p, int r, int z, int b, bool RS) {
         int j, z2, p2, c;
         int i, count, order[20]; // used for lex generation
+        Profile::enter(t);
 
         // Incremental comparison of a[r+1...n] with its reversal
         if (t - 1 > (N - r) / 2 + r) {
@@ -144,6 +151,7 @@ public:
             if (num[2] > 0 && t != r + 1 &&
                 (B[b + 1].s != 2 || B[b + 1].v < num[2]))
                 RS = false;
+            Profile::leaf(t);
             if ((RS == false) && (N == p))
                 Print();
         }
@@ -178,6 +186,8 @@ public:
                     GenBF(t + 1, p2, t, z2, nb, false);
                 if (c == 1)
                     GenBF(t + 1, p2, r, z2, b, RS);
+                if (c == -1)
+                    Profile::prune(t + 1);
                 if (num[j] == 0)
                     Add(j);
                 num[j]++;
@@ -217,6 +227,9 @@ public:
                 GenBF(3, p2, 2, z2, nb, false);
             else if (c == 1)
                 GenBF(3, p2, 1, z2, 1, RS);
+            else
+                Profile::prune(3);
+            Profile::finish(&a[1], 2);
             num[j]++;
             RestoreRunLength();
         }
@@ -229,28 +242,39 @@ public:
     }
 
     static void usage() {
-        printf("Usage: necklace [n] [d] (n>=3, d>=3, n>=d*(d-1)+1)\n");
+        printf("Usage: necklace [n] [d] [--profile=file] (n>=3, d>=3, n>=d*(d-1)+1)\n");
     }
 };
 
-void InitParallel(int N, int D) {
-    NecklaceGenerator generator(N, D);
-    generator.Init();
+void InitParallel(int N, int D, const char *profile) {
+    if (profile != nullptr) {
+        NecklaceGenerator<DepthProfile<MAX + 1>> generator(N, D);
+        generator.Init();
+    } else {
+        NecklaceGenerator<> generator(N, D);
+        generator.Init();
+    }
 }
 
 int main(int argc, char **argv) {
     if (argc < 3) {
-        NecklaceGenerator::usage();
+        NecklaceGenerator<>::usage();
         return 1;
     }
     int N = atoi(argv[1]);
     int D = atoi(argv[2]);
+    const char *profile = nullptr;
+    if (argc > 3 && strncmp(argv[3], "--profile=", 10) == 0) profile = argv[3] + 10;
 
-    if (N < 3 || D < 3 || N > D * (D - 1) + 1) {
-        NecklaceGenerator::usage();
+    if (N < 3 || D < 3 || N > D * (D - 1) + 1 || (argc > 3 && profile == nullptr)) {
+        NecklaceGenerator<>::usage();
+        return 1;
+    }
+    InitParallel(N, D, profile);
+    if (profile != nullptr && !ProfileLog::global().dump(profile)) {
+        printf("Error: cannot write profile %s\n", profile);
         return 1;
     }
-    InitParallel(N, D);
     printf("Finished successfully\n");
     return 0;
 }
@@ -0,0 +1,158 @@
+/*
+catalogue.cpp
+
+Builds and queries a catalogue of covers (see Catalogue.h).
+
+  catalogue build covers.dcc diffcover.txt dc_72_10.dcz dc_64_9.txt ...
+  catalogue get covers.dcc 133          a cover of N=133 with the smallest D
+  catalogue get covers.dcc 72 10 --all  every stored cover of (72, 10)
+  catalogue list covers.dcc             N, D, number of covers, optimal
+
+`build` takes tables in the layout of diffcover.txt ("N: a[1] .. a[D]",
+with a trailing "?" where D is not known to be the smallest) and search
+output in any format CoverReader reads (text, binary or compact).  Rows of
+a table without "?" are marked optimal.  Every cover is checked before it
+goes in, and each (N, D) keeps one copy of each cover however often it was
+found.  The catalogue is rewritten as a whole: to add output to an
+existing one, build it again from all inputs.
+*/
+
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "Catalogue.h"
+#include "CoverStream.h"
+
+static void usage() {
+    printf(
+        "Usage: catalogue build file.dcc input...\n"
+        "       catalogue get file.dcc N [D] [--all]\n"
+        "       catalogue list file.dcc\n");
+}
+
+// Adds the rows of a diffcover.txt table; false if `path` is no table
+static bool ReadTable(const char *path, CatalogueBuilder &builder, int &added, int &rejected) {
+    FILE *file = fopen(path, "r");
+    if (file == nullptr) return false;
+    char line[4096];
+    bool table = false;
+    while (fgets(line, sizeof(line), file) != nullptr) {
+        char *pos = line;
+        while (isspace(static_cast<unsigned char>(*pos))) ++pos;
+        if (*pos == '\0') continue;
+        char *end;
+        const long N = strtol(pos, &end, 10);
+        if (end == pos || *end != ':') {
+            if (!table) break;  // not a table after all
+            continue;
+        }
+        table = true;
+        std::vector<int> a;
+        bool optimal = true;
+        for (pos = end + 1; *pos != '\0';) {
+            if (isdigit(static_cast<unsigned char>(*pos))) {
+                a.push_back(static_cast<int>(strtol(pos, &pos, 10)));
+            } else {
+                if (*pos == '?') optimal = false;
+                ++pos;
+            }
+        }
+        if (!a.empty()
+            && builder.add(static_cast<int>(N), a.data(), static_cast<int>(a.size()), optimal)) {
+            ++added;
+        } else {
+            ++rejected;
+        }
+    }
+    fclose(file);
+    return table;
+}
+
+static int Build(const char *path, int num_inputs, const char *const inputs[]) {
+    CatalogueBuilder builder;
+    for (int idx = 0; idx < num_inputs; ++idx) {
+        int added = 0;
+        int rejected = 0;
+        if (!ReadTable(inputs[idx], builder, added, rejected)) {
+            CoverReader reader;
+            if (!reader.open(inputs[idx])) {
+                fprintf(stderr, "Error: cannot read covers from %s\n", inputs[idx]);
+                return 1;
+            }
+            std::vector<int> cover(reader.D());
+            while (reader.next(cover.data())) {
+                if (builder.add(reader.N(), cover.data(), reader.D())) {
+                    ++added;
+                } else {
+                    ++rejected;
+                }
+            }
+        }
+        printf("%s: %d covers", inputs[idx], added);
+        if (rejected > 0) printf(", %d rejected", rejected);
+        printf("\n");
+    }
+    if (!builder.write(path)) {
+        fprintf(stderr, "Error: cannot write %s\n", path);
+        return 1;
+    }
+    return 0;
+}
+
+static void Print(const Catalogue &catalogue, const CatalogueEntry &entry, uint32_t idx) {
+    const uint16_t *a = catalogue.cover(entry, idx);
+    for (int pos = 0; pos < entry.D; ++pos) printf("%3d ", a[pos]);
+    printf("\n");
+}
+
+int main(int argc, const char *argv[]) {
+    if (argc >= 4 && strcmp(argv[1], "build") == 0) return Build(argv[2], argc - 3, argv + 3);
+    if (argc < 3 || (strcmp(argv[1], "get") != 0 && strcmp(argv[1], "list") != 0)) {
+        usage();
+        return 1;
+    }
+
+    Catalogue catalogue;
+    if (!catalogue.open(argv[2])) {
+        fprintf(stderr, "Error: %s is no catalogue\n", argv[2]);
+        return 1;
+    }
+    if (strcmp(argv[1], "list") == 0) {
+        for (size_t idx = 0; idx < catalogue.size(); ++idx) {
+            const CatalogueEntry &entry = catalogue.entry(idx);
+            printf("%3u %2u %8u%s\n", entry.N, entry.D, entry.count,
+                   (entry.flags & CATALOGUE_OPTIMAL) != 0 ? " optimal" : "");
+        }
+        return 0;
+    }
+
+    if (argc < 4) {
+        usage();
+        return 1;
+    }
+    const int N = atoi(argv[3]);
+    int D = 0;
+    bool all = false;
+    for (int idx = 4; idx < argc; ++idx) {
+        if (strcmp(argv[idx], "--all") == 0) {
+            all = true;
+        } else if (isdigit(static_cast<unsigned char>(argv[idx][0]))) {
+            D = atoi(argv[idx]);
+        } else {
+            usage();
+            return 1;
+        }
+    }
+    const CatalogueEntry *entry = D > 0 ? catalogue.find(N, D) : catalogue.best(N);
+    if (entry == nullptr) {
+        const std::string which = D > 0 ? " D=" + std::to_string(D) : "";
+        fprintf(stderr, "No cover of N=%d%s in %s\n", N, which.c_str(), argv[2]);
+        return 1;
+    }
+    for (uint32_t idx = 0; idx < (all ? entry->count : 1); ++idx) Print(catalogue, *entry, idx);
+    return 0;
+}
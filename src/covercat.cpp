@@ -0,0 +1,112 @@
+/*
+covercat.cpp
+
+Prints or converts the covers a search wrote.  It reads any file
+CoverReader understands (compact "DCZ1" files, fixed-width binary "DCB1"
+files or the text the searches print) and writes the covers in any format
+of CoverSink:
+
+  covercat dc_72_10.dcz                      text, as the search printed it
+  covercat dc_72_10.dcz --from=4096 --count=10
+  covercat dc_72_10.txt --format=compact --output=dc_72_10.dcz
+  covercat dc_72_10.dcz --info
+
+--from=k starts at the k-th cover (counting from 0); compact files with an
+index and binary files seek there, other inputs are read up to it.
+--count=m stops after m covers.  --info prints the format, N, D and the
+number of covers instead of the covers.  As with the searches, binary and
+compact output need --output=file.
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "CoverSink.h"
+#include "CoverStream.h"
+
+static void usage() {
+    printf(
+        "Usage: covercat file [--format=text|binary|ndjson|compact] [--output=file] [--from=k] "
+        "[--count=m] [--info]\n");
+}
+
+int main(int argc, const char *argv[]) {
+    if (argc < 2) {
+        usage();
+        return 1;
+    }
+    CoverFormat format = CoverFormat::Text;
+    const char *output = nullptr;
+    long long from = 0;
+    long long count = -1;
+    bool info = false;
+    for (int idx = 2; idx < argc; ++idx) {
+        if (strcmp(argv[idx], "--format=text") == 0) {
+            format = CoverFormat::Text;
+        } else if (strcmp(argv[idx], "--format=binary") == 0) {
+            format = CoverFormat::Binary;
+        } else if (strcmp(argv[idx], "--format=ndjson") == 0) {
+            format = CoverFormat::Json;
+        } else if (strcmp(argv[idx], "--format=compact") == 0) {
+            format = CoverFormat::Compact;
+        } else if (strncmp(argv[idx], "--output=", 9) == 0) {
+            output = argv[idx] + 9;
+        } else if (strncmp(argv[idx], "--from=", 7) == 0) {
+            from = atoll(argv[idx] + 7);
+        } else if (strncmp(argv[idx], "--count=", 8) == 0) {
+            count = atoll(argv[idx] + 8);
+        } else if (strcmp(argv[idx], "--info") == 0) {
+            info = true;
+        } else {
+            usage();
+            return 1;
+        }
+    }
+    if (from < 0
+        || ((format == CoverFormat::Binary || format == CoverFormat::Compact) && output == nullptr)) {
+        usage();
+        return 1;
+    }
+
+    CoverReader reader;
+    if (!reader.open(argv[1])) {
+        fprintf(stderr, "Error: cannot read covers from %s\n", argv[1]);
+        return 1;
+    }
+    const int D = reader.D();
+    std::vector<int> cover(D);
+
+    if (info) {
+        static const char *const kinds[] = {"compact", "binary", "text"};
+        long long covers = reader.size();
+        if (covers < 0) {
+            covers = 0;
+            while (reader.next(cover.data())) ++covers;
+        }
+        printf("%s N=%d D=%d covers=%lld%s\n", kinds[reader.format()], reader.N(), D, covers,
+               reader.format() == CoverReader::Compact && !reader.indexed() ? " (no index)" : "");
+        return 0;
+    }
+
+    if (!reader.seek(from)) {
+        for (long long skipped = 0; skipped < from && reader.next(cover.data()); ++skipped) {
+        }
+    }
+    std::unique_ptr<FILE, int (*)(FILE *)> file(output != nullptr ? fopen(output, "wb") : nullptr,
+                                                 fclose);
+    if (output != nullptr && file == nullptr) {
+        fprintf(stderr, "Error: cannot write %s\n", output);
+        return 1;
+    }
+    {
+        CoverSink sink(file != nullptr ? file.get() : stdout, format, reader.N(), D);
+        CoverSink::Buffer covers(&sink);
+        for (long long done = 0; (count < 0 || done < count) && reader.next(cover.data()); ++done) {
+            covers.put(cover.data(), D);
+        }
+    }
+    return 0;
+}
@@ -213,9 +213,8 @@ class DcGenerator {
 
 // Initialize parallel computation with thread pool
 void InitParallel(int N, int D) {
-    const unsigned num_workers = std::thread::hardware_concurrency();
-    ThreadPool pool(num_workers);
-    printf("Number of workers: %u\n", num_workers / 2);
+    ThreadPool pool;
+    printf("Number of workers: %zu\n", pool.size());
 
     std::vector<std::future<void>> results;
     results.reserve((N + 1) / 2 - (N - 1) / D);  // Pre-allocate space
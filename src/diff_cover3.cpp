@@ -1,31 +1,116 @@
 /*
 **diff_cover3.cpp**
 
-This code is a mathematical program that searches for special number sequences called "difference covers." A difference cover is a set of numbers where the differences between any two numbers in the set can represent all possible values within a certain range. Think of it like finding a minimal set of positions on a number line such that the distances between these positions cover all the gaps you might need.
+This code is a mathematical program that searches for special number sequences called "difference
+covers." A difference cover is a set of numbers where the differences between any two numbers in the
+set can represent all possible values within a certain range. Think of it like finding a minimal set
+of positions on a number line such that the distances between these positions cover all the gaps you
+might need.
 
 **Purpose and Input**
 
-The program takes two command-line arguments: N (the range size) and D (the size of the difference cover set). For example, if you run the program with N=15 and D=5, it will search for sets of 5 numbers within the range 0 to 14 that form valid difference covers. The program has built-in constraints requiring both N and D to be at least 3, and N cannot exceed D*(D-1)+1.
+The program takes two command-line arguments: N (the range size) and D (the size of the difference
+cover set). For example, if you run the program with N=15 and D=5, it will search for sets of 5
+numbers within the range 0 to 14 that form valid difference covers. The program has built-in
+constraints requiring both N and D to be at least 3, and N cannot exceed D*(D-1)+1. The optional
+flags are listed in diff_cover3.md (section 8.3).
+
+`--engine=` selects how differences are tracked: `counter`, the original per-difference counters,
+`bitset`, word-parallel bitsets from `DiffSet.h`, or `driven`, a separate exact search that branches
+on the uncovered difference with the fewest candidate positions instead of on the next position,
+which explores far fewer nodes when N is close to D*(D-1)+1. `--bench` times every engine on the
+same problem without printing and checks that they find the same number of covers.
+
+All arrays are sized by a capacity class from `Capacity.h` picked from N and D at startup, so N up
+to 4096 runs without recompiling and larger inputs are rejected instead of overflowing. Built with
+`-DDC_SPECIALIZED`, the program also instantiates a kernel with N and D fixed at compile time for
+every row of `diffcover.txt` (listed in `dc_kernels.inc`) and uses it whenever the (N, D) pair
+matches; `--generic` forces the runtime engine.
 
 **Output**
 
-When the program finds valid difference covers, it prints them as sequences of numbers. Each valid sequence is displayed on a separate line, showing the D numbers that make up the difference cover. The program also displays progress information, including the number of worker threads being used and a countdown showing how many search tasks remain.
+When the program finds valid difference covers, it prints them as sequences of numbers. Each valid
+sequence is displayed on a separate line, showing the D numbers that make up the difference cover.
+The program also displays progress information, including the number of worker threads being used
+and a countdown showing how many search tasks remain.
 
 **How It Works**
 
-The program uses a sophisticated backtracking algorithm implemented in the `DcGenerator` class. This algorithm systematically builds potential difference covers one number at a time, checking at each step whether the partial sequence could lead to a valid complete difference cover. The core idea is to maintain arrays that track which numbers have been used (`q` array) and which difference values have been covered (`differences` array).
+The program uses a sophisticated backtracking algorithm implemented in the `DcGenerator` class. This
+algorithm systematically builds potential difference covers one number at a time, checking at each
+step whether the partial sequence could lead to a valid complete difference cover. The core idea is
+to maintain arrays that track which numbers have been used (`q` array) and which difference values
+have been covered (`differences` array).
+
+The algorithm starts with a fixed first number and then tries different possibilities for subsequent
+positions. For each potential number it might add to the sequence, it calculates what new
+differences would be created and checks if adding this number brings the sequence closer to covering
+all required differences. If a partial sequence looks promising (meaning it has covered enough
+differences for its current length), the algorithm continues building on it. If not, it backtracks
+and tries a different number.
 
-The algorithm starts with a fixed first number and then tries different possibilities for subsequent positions. For each potential number it might add to the sequence, it calculates what new differences would be created and checks if adding this number brings the sequence closer to covering all required differences. If a partial sequence looks promising (meaning it has covered enough differences for its current length), the algorithm continues building on it. If not, it backtracks and tries a different number.
+Two admissible bounds decide this. `pairs` requires that even if every pair still to be formed
+covered a new difference the count would reach N/2. `lookahead` adds that the elements still to be
+placed all lie between the last one and N-1, so the pairs among them can only cover the uncovered
+differences that fit in that gap. For composite N, `divisors` checks the projections onto Z_m for
+the divisors m of N, since a cover of Z_N maps onto a cover of every Z_m (`ProjectedDiffs`).
+
+A cover stays a cover under every map x -> kx + c with k coprime to N. With `--orbits` each valid
+leaf is checked against its images under the multipliers k (see `Orbit.h`) and reported only if it
+leads its orbit, so the output holds one cover per affine class. `DcGenerator` also cuts inner nodes
+none of whose completions can lead their orbit; the difference-driven engine only filters its
+leaves.
 
 **Key Logic Flow**
 
-The program employs parallel processing to speed up the search. It divides the work by trying different starting values simultaneously across multiple threads. Each thread runs its own instance of the search algorithm (`BraceFD11` method), which recursively explores possible sequences using the `BraceFD` method.
+The program employs parallel processing to speed up the search. It divides the work by trying
+different starting values simultaneously across multiple threads. The pool has one worker per
+physical core the process may use, capped by the cgroup CPU quota (`Topology.h`).
+
+Each task runs its own instance of the search algorithm (`Resume` from a prefix, `BraceFD11` for a
+whole first element), which explores possible sequences with the iterative `Search` method. `Search`
+keeps one frame per depth instead of recursing, so a search can be paused and resumed, or list its
+untried work as prefixes with `Frontier`.
+
+Whenever a worker goes idle, a generator hands half of the remaining children of one of its shallow
+frames to the pool as a prefix `a[1..t]`, so a few giant first-element subtrees do not keep the
+other cores waiting. `--lpt` starts the largest `a[1]` subtrees first, by their estimated or
+previously measured size.
 
-Two critical functions manage the search state: `step_forward` adds a new number to the current sequence and updates the count of covered differences, while `step_backward` removes a number and undoes those updates. This allows the algorithm to efficiently explore and backtrack through the search space.
+The last level is resolved in a batch: `BatchLeaves` intersects the shifts of the chosen positions
+by the still-uncovered differences, which yields every last element that can complete the cover, and
+the search only visits those.
 
-The program also includes symmetry-breaking optimizations through the `CheckRev` function, which helps avoid generating equivalent sequences that are just mirror images of each other. This significantly reduces the search space without missing any fundamentally different solutions.
+Two critical functions manage the search state: `step_forward` adds a new number to the current
+sequence and updates the count of covered differences, while `step_backward` removes a number and
+undoes those updates. This allows the algorithm to efficiently explore and backtrack through the
+search space.
 
-When a complete sequence of D numbers is built, the `PrintD` function performs final validation checks to ensure it forms a proper difference cover before printing it as output. The program continues until all possible valid difference covers for the given parameters have been found and displayed.
+The program also includes symmetry-breaking optimizations through the `CheckRev` function, which
+helps avoid generating equivalent sequences that are just mirror images of each other. This
+significantly reduces the search space without missing any fundamentally different solutions.
+
+When a complete sequence of D numbers is built, the `PrintD` function performs final validation
+checks to ensure it forms a proper difference cover before printing it as output. The program
+continues until all possible valid difference covers for the given parameters have been found and
+displayed.
+
+Covers are not printed by the workers themselves: each search encodes them into a buffer of its own
+and hands it to a `CoverSink` (`CoverSink.h`), whose writer thread is the only one writing the
+output. Besides text it writes binary, NDJSON or the compact indexed format of `CoverStream.h`,
+which the `covercat` tool reads back.
+
+With `--first` the worker that finds a cover raises a shared cancellation flag and the other
+searches unwind at their next node. With `--count` each task counts its leaves locally and the
+program reports the count per `a[1]` and the total.
+
+`--checkpoint=file` saves the unfinished prefixes, the counts and the output length at regular
+intervals, and `--resume` continues from there. `--coordinate=dir` spreads one enumeration over
+`necklace --work=dir` processes sharing a work directory (`WorkDir.h`).
+
+`--estimate` sizes every `a[1]` subtree with Knuth's estimator (`Estimate`) and reports progress and
+the time left on stderr. `--profile` counts nodes, cuts and leaves per depth (`Profile.h`), and
+`--perf` reads hardware counters per task (`PerfCounters.h`).
 */
 
 /*
@@ -46,21 +131,35 @@ When a complete sequence of D numbers is built, the `PrintD` function performs f
  */
 
 #include <stdint.h>
+#include <sys/stat.h>
+#include <unistd.h>  // for fsync, ftruncate
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>  // for memset, memcpy
 #include <future>   // for future
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
 #include <vector>
 
+#include "Capacity.h"
+#include "CoverSink.h"
+#include "DiffSet.h"
+#include "Orbit.h"
+#include "PerfCounters.h"
+#include "Profile.h"
 #include "ThreadPool.h"
+#include "WorkDir.h"
 
-static constexpr int MAX_N = 256;
-static constexpr int MAX_C = 128;
-static constexpr int MAX_D = 20;
-
-class DcGenerator {
-  private:
+// Problem bounds known only at run time (the generic engine).
+struct RuntimeDims {
     const int N;
     const int D;
     const int ND;
@@ -68,21 +167,560 @@ class DcGenerator {
     const int N2;
     const int N1;
 
-    int a[MAX_D];
-    int q[MAX_N];
-    // int s[MAX_N];
+    RuntimeDims(int n, int d)
+        : N(n), D(d), ND(N - D), D1(D - 1), N2(N / 2), N1(N2 - D * D1 / 2) {}
+};
+
+// Problem bounds fixed at compile time, so the prune threshold, the loop
+// bounds and the N - p_diff fold become constants (see dc_kernels.inc).
+template <int CN, int CD>
+struct FixedDims {
+    static constexpr int N = CN;
+    static constexpr int D = CD;
+    static constexpr int ND = N - D;
+    static constexpr int D1 = D - 1;
+    static constexpr int N2 = N / 2;
+    static constexpr int N1 = N2 - D * D1 / 2;
+
+    FixedDims(int, int) {}
+};
+
+template <int CN, int CD> constexpr int FixedDims<CN, CD>::N;
+template <int CN, int CD> constexpr int FixedDims<CN, CD>::D;
+template <int CN, int CD> constexpr int FixedDims<CN, CD>::ND;
+template <int CN, int CD> constexpr int FixedDims<CN, CD>::D1;
+template <int CN, int CD> constexpr int FixedDims<CN, CD>::N2;
+template <int CN, int CD> constexpr int FixedDims<CN, CD>::N1;
+
+// Admissible bounds checked on entering a node, cheapest first.  Each one
+// proves that the partial cover a[0..t] can no longer reach all N/2 folded
+// differences; --bound= picks the ones that run and --stats reports how many
+// nodes each of them cut.  `divisors` is off by default: on the sizes we
+// have timed it cuts well under 1% of the nodes and costs more than it saves.
+enum Bound { BOUND_PAIRS, BOUND_LOOKAHEAD, BOUND_DIVISORS, NUM_BOUNDS };
+static const char *const bound_names[NUM_BOUNDS] = {"pairs", "lookahead", "divisors"};
+static constexpr unsigned DEFAULT_BOUNDS = (1u << BOUND_PAIRS) | (1u << BOUND_LOOKAHEAD);
+
+// Per-task counters, folded into the SearchContext when a task finishes
+struct SearchStats {
+    long long found = 0;
+    long long nodes = 0;  // nodes entered above the leaves
+    long long cuts[NUM_BOUNDS] = {};
+    long long non_leaders = 0;  // covers and nodes dropped as not leading their orbit
+
+    void add(const SearchStats &other) {
+        found += other.found;
+        nodes += other.nodes;
+        non_leaders += other.non_leaders;
+        for (int idx = 0; idx < NUM_BOUNDS; ++idx) cuts[idx] += other.cuts[idx];
+    }
+};
+
+// A subtree of the search: the node at depth t below the prefix a[1..t],
+// entered with periodicity p and reversal marker r1, restricted to the
+// children a[t + 1] in [lo, hi] (hi < 0 for all of them).  The q marks and
+// the difference state are rebuilt from a[].
+struct Prefix {
+    int t;
+    int p;
+    int r1;
+    std::vector<int> a;  // a[1..t]
+    int hi;
+    int lo;
+};
+
+enum class Engine { Counter, Bitset, Driven };
+
+// Run-time settings shared by all engines
+struct Options {
+    Engine engine = Engine::Counter;
+    bool print = true;
+    bool bench = false;
+    bool generic = false;
+    bool first = false;  // stop at the first cover found
+    bool orbits = false;  // one cover per orbit of x -> kx + c
+    bool count = false;  // report per-a[1] and total counts instead of covers
+    bool stats = false;  // report nodes and the cuts of each bound
+    unsigned bounds = DEFAULT_BOUNDS;
+    int split_depth = -1;  // deepest child handed to idle workers; -1 for D - 4
+    const char *checkpoint = nullptr;  // checkpoint file, none if null
+    int checkpoint_interval = 300;     // seconds between checkpoints
+    bool resume = false;               // continue from the checkpoint file
+    const char *coordinate = nullptr;  // work directory to hand out tasks in
+    int lease = 60;                    // seconds before an unrenewed task is reissued
+    int estimate = 0;                  // random probes per a[1] for the size estimate
+    bool estimate_only = false;        // stop after printing the estimate
+    const char *profile = nullptr;     // per-depth profile output (.csv or .json)
+    bool perf = false;                 // hardware counters per task and a[1]
+    bool lpt = false;                  // start the largest a[1] subtrees first
+    const char *costs = nullptr;       // nodes per a[1] of earlier runs, for --lpt
+    CoverFormat format = CoverFormat::Text;
+    const char *output = nullptr;  // file for the covers, stdout if null
+};
+
+// Everything needed to continue an enumeration: the counters so far, the
+// stdout offset of the covers printed so far (-1 if stdout is no file) and
+// the prefixes of all unfinished work.
+struct CheckpointState {
+    int N;
+    int D;
+    bool orbits;
+    long long output_offset;
+    std::vector<long long> found_by_first;
+    SearchStats stats;
+    std::vector<Prefix> frontier;
+};
+
+// Binary layout, native byte order: "DCK1", int32 N, D, orbits, int64
+// output offset, int64 found_by_first[0..N], the SearchStats counters,
+// int32 prefix count, then per prefix int32 t, p, r1, hi, lo, a[1..t].
+// Written to `path`.tmp, synced and renamed over `path`, so a preempted
+// run always leaves the previous or the new checkpoint intact.
+static bool WriteCheckpoint(const char *path, const CheckpointState &state) {
+    const std::string tmp = std::string(path) + ".tmp";
+    FILE *file = fopen(tmp.c_str(), "wb");
+    if (file == nullptr) return false;
+    std::vector<int64_t> wide;
+    std::vector<int32_t> narrow;
+    narrow.push_back(state.N);
+    narrow.push_back(state.D);
+    narrow.push_back(state.orbits);
+    wide.push_back(state.output_offset);
+    for (int idx = 0; idx <= state.N; ++idx) wide.push_back(state.found_by_first[idx]);
+    wide.push_back(state.stats.nodes);
+    for (int idx = 0; idx < NUM_BOUNDS; ++idx) wide.push_back(state.stats.cuts[idx]);
+    wide.push_back(state.stats.non_leaders);
+    std::vector<int32_t> prefixes;
+    prefixes.push_back(static_cast<int32_t>(state.frontier.size()));
+    for (size_t idx = 0; idx < state.frontier.size(); ++idx) {
+        const Prefix &prefix = state.frontier[idx];
+        const int32_t head[5] = {prefix.t, prefix.p, prefix.r1, prefix.hi, prefix.lo};
+        prefixes.insert(prefixes.end(), head, head + 5);
+        prefixes.insert(prefixes.end(), prefix.a.begin(), prefix.a.end());
+    }
+    bool ok = fwrite("DCK1", 1, 4, file) == 4
+              && fwrite(narrow.data(), sizeof(int32_t), narrow.size(), file) == narrow.size()
+              && fwrite(wide.data(), sizeof(int64_t), wide.size(), file) == wide.size()
+              && fwrite(prefixes.data(), sizeof(int32_t), prefixes.size(), file) == prefixes.size()
+              && fflush(file) == 0 && fsync(fileno(file)) == 0;
+    ok = fclose(file) == 0 && ok;
+    return ok && rename(tmp.c_str(), path) == 0;
+}
+
+// Whether `prefix` is a task a search of (N, D) can have saved: 1 <= p <= t
+// < D - 1, 0 < a[1] < ... < a[t] < N and the children a[t] < lo <= hi < N,
+// or hi < 0 for all of them
+static bool ValidPrefix(const Prefix &prefix, int N, int D) {
+    if (prefix.t < 1 || prefix.t >= D - 1 || prefix.p < 1 || prefix.p > prefix.t) return false;
+    int last = 0;
+    for (int idx = 0; idx < prefix.t; ++idx) {
+        if (prefix.a[idx] <= last || prefix.a[idx] >= N) return false;
+        last = prefix.a[idx];
+    }
+    return prefix.hi < 0 || (last < prefix.lo && prefix.lo <= prefix.hi && prefix.hi < N);
+}
+
+// Reads a checkpoint of the run (N, D); false if it is not one, or corrupt
+static bool ReadCheckpoint(const char *path, int N, int D, CheckpointState &state) {
+    FILE *file = fopen(path, "rb");
+    if (file == nullptr) return false;
+    char magic[4];
+    int32_t narrow[3];
+    bool ok = fread(magic, 1, 4, file) == 4 && memcmp(magic, "DCK1", 4) == 0
+              && fread(narrow, sizeof(int32_t), 3, file) == 3 && narrow[0] == N && narrow[1] == D;
+    if (ok) {
+        state.N = narrow[0];
+        state.D = narrow[1];
+        state.orbits = narrow[2] != 0;
+        std::vector<int64_t> wide(1 + (state.N + 1) + 1 + NUM_BOUNDS + 1);
+        ok = fread(wide.data(), sizeof(int64_t), wide.size(), file) == wide.size();
+        if (ok) {
+            size_t pos = 0;
+            state.output_offset = wide[pos++];
+            state.found_by_first.assign(wide.begin() + 1, wide.begin() + 1 + state.N + 1);
+            pos += state.N + 1;
+            state.stats = SearchStats();
+            state.stats.nodes = wide[pos++];
+            for (int idx = 0; idx < NUM_BOUNDS; ++idx) state.stats.cuts[idx] = wide[pos++];
+            state.stats.non_leaders = wide[pos++];
+            for (int idx = 0; idx <= state.N; ++idx) state.stats.found += state.found_by_first[idx];
+        }
+    }
+    int32_t num = 0;
+    ok = ok && fread(&num, sizeof(num), 1, file) == 1;
+    state.frontier.clear();
+    for (int32_t idx = 0; ok && idx < num; ++idx) {
+        int32_t head[5];
+        ok = fread(head, sizeof(int32_t), 5, file) == 5 && head[0] >= 1 && head[0] < D - 1;
+        if (!ok) break;
+        Prefix prefix{head[0], head[1], head[2], std::vector<int>(head[0]), head[3], head[4]};
+        std::vector<int32_t> a(head[0]);
+        ok = fread(a.data(), sizeof(int32_t), a.size(), file) == a.size();
+        prefix.a.assign(a.begin(), a.end());
+        ok = ok && ValidPrefix(prefix, N, D);
+        state.frontier.push_back(prefix);
+    }
+    fclose(file);
+    return ok;
+}
+
+// Nodes per a[1] of a finished run, for ordering the next one (--costs):
+// a line "# N D", then one line "a[1] nodes" per first element.
+static bool ReadCosts(const char *path, int N, int D, std::vector<double> &cost) {
+    FILE *file = fopen(path, "r");
+    if (file == nullptr) return false;
+    int file_N;
+    int file_D;
+    bool ok = fscanf(file, "# %d %d", &file_N, &file_D) == 2 && file_N == N && file_D == D;
+    cost.assign(N + 1, 0);
+    int a1;
+    double nodes;
+    while (ok && fscanf(file, "%d %lf", &a1, &nodes) == 2) {
+        if (a1 < 0 || a1 > N) ok = false;
+        if (ok) cost[a1] = nodes;
+    }
+    fclose(file);
+    return ok;
+}
+
+static bool WriteCosts(const char *path, int N, int D, const std::vector<long long> &nodes) {
+    const std::string tmp = std::string(path) + ".tmp";
+    FILE *file = fopen(tmp.c_str(), "w");
+    if (file == nullptr) return false;
+    fprintf(file, "# %d %d\n", N, D);
+    for (int idx = (N + 1) / 2; idx >= (N - 1) / D + 1; --idx) {
+        fprintf(file, "%d %lld\n", idx, nodes[idx]);
+    }
+    const bool ok = fclose(file) == 0;
+    return ok && rename(tmp.c_str(), path) == 0;
+}
+
+// Shared state of one parallel enumeration.  Whenever a worker is idle, a
+// generator hands half of the remaining children of one of its frames at
+// depth < `split_depth` to the pool as a Prefix, so the a[1] partition is
+// refined on demand.
+//
+// In find-first mode the first generator to reach a valid leaf claims it by
+// setting `cancelled`; every search loop polls the flag and unwinds, and
+// tasks still queued return without searching.
+//
+// With a checkpoint file every task is registered: queued ones by their
+// Prefix, running ones by count.  Every `checkpoint_interval` seconds wait()
+// raises `pause`; running generators notice it between search slices,
+// publish their Frontier and counters and block, and once all of them have,
+// the queued and published prefixes are written out as one consistent cut
+// of the enumeration.
+struct SearchContext {
+    ThreadPool &pool;
+    const int split_depth;
+    const bool first;
+    const unsigned bounds;
+    const bool orbits;
+    std::atomic<bool> cancelled;
+    std::atomic<long long> found;
+    std::mutex mutex;
+    std::condition_variable done;
+    int outstanding;
+    std::vector<long long> found_by_first;  // covers per a[1], guarded by mutex
+    SearchStats stats;                      // guarded by mutex
+    CoverSink *sink;                        // where the generators print covers
+
+    // Progress against the estimated tree size (--estimate).  Generators
+    // add their node counts to `progress` every PROGRESS_CHUNK nodes and
+    // fold() adds the rest; the other fields are guarded by mutex.
+    static constexpr long long PROGRESS_CHUNK = 1 << 16;
+    static constexpr int PROGRESS_INTERVAL = 10;  // seconds between reports
+    std::atomic<long long> progress;
+    std::vector<double> estimate;           // estimated nodes per a[1], empty if none
+    std::vector<long long> nodes_by_first;  // nodes of the tasks folded in this run
+    std::vector<int> open_by_first;         // tasks not yet finished per a[1]
+    long long base_nodes;                   // nodes before a resumed run
+    std::chrono::steady_clock::time_point started;
+
+    // Hardware counters of every task, summed per a[1] (--perf), guarded by mutex
+    const bool perf;
+    std::vector<PerfSample> perf_by_first;
+
+    // Checkpoints, all guarded by mutex except `pause`
+    const int N;
+    const int D;
+    const char *checkpoint;
+    const int checkpoint_interval;
+    std::map<long long, Prefix> queued;  // submitted tasks not started yet
+    long long next_id;
+    int running;
+    int paused;
+    bool checkpointing;
+    std::atomic<bool> pause;
+    std::condition_variable resumed;
+    std::vector<Prefix> published;  // frontiers of the paused tasks
+
+    SearchContext(ThreadPool &pool, const Options &opts, int split_depth, int N, int D)
+        : pool(pool),
+          split_depth(split_depth),
+          first(opts.first),
+          bounds(opts.bounds),
+          orbits(opts.orbits),
+          cancelled(false),
+          found(0),
+          outstanding(0),
+          found_by_first(N + 1, 0),
+          sink(nullptr),
+          progress(0),
+          nodes_by_first(N + 1, 0),
+          open_by_first(N + 1, 0),
+          base_nodes(0),
+          started(std::chrono::steady_clock::now()),
+          perf(opts.perf),
+          perf_by_first(N + 1),
+          N(N),
+          D(D),
+          checkpoint(opts.checkpoint),
+          checkpoint_interval(opts.checkpoint_interval),
+          next_id(0),
+          running(0),
+          paused(0),
+          checkpointing(false),
+          pause(false) {}
+
+    // Queues a task that searches the subtree of `prefix` with a Generator;
+    // with a `cost` >= 0 queued tasks start in order of decreasing cost
+    template <class Generator>
+    void submit(bool print, const Prefix &prefix, double cost = -1) {
+        long long id;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            ++outstanding;
+            ++open_by_first[prefix.a[0]];
+            id = next_id++;
+            queued.emplace(id, prefix);
+        }
+        auto task = [this, print, id]() {
+            const Prefix prefix = start_task(id);
+            if (cancelled) {
+                end_task(prefix.a[0], SearchStats());
+                return;
+            }
+            const PerfSample before = perf ? PerfCounters::thread().read() : PerfSample();
+            Generator generator(N, D, prefix, print, this);
+            generator.Resume(prefix);
+            generator.flush_covers();
+            if (perf) {
+                const PerfSample cost = PerfCounters::thread().read().since(before);
+                std::unique_lock<std::mutex> lock(mutex);
+                perf_by_first[prefix.a[0]].add(cost);
+            }
+            end_task(prefix.a[0], generator.search_stats());
+        };
+        if (cost >= 0) {
+            pool.enqueue(Priority(cost), task);
+        } else {
+            pool.enqueue(task);
+        }
+    }
+
+    Prefix start_task(long long id) {
+        std::unique_lock<std::mutex> lock(mutex);
+        resumed.wait(lock, [this]() { return !checkpointing; });
+        std::map<long long, Prefix>::iterator it = queued.find(id);
+        const Prefix prefix = it->second;
+        queued.erase(it);
+        ++running;
+        return prefix;
+    }
+
+    // Each task counts locally and folds its counters in here, once at the
+    // end and at every checkpoint it takes part in
+    void fold(int a1, const SearchStats &task) {
+        found += task.found;
+        found_by_first[a1] += task.found;
+        stats.add(task);
+        nodes_by_first[a1] += task.nodes;
+        progress.fetch_add(task.nodes & (PROGRESS_CHUNK - 1), std::memory_order_relaxed);
+    }
+
+    void end_task(int a1, const SearchStats &task) {
+        std::unique_lock<std::mutex> lock(mutex);
+        fold(a1, task);
+        --open_by_first[a1];
+        --running;
+        --outstanding;
+        done.notify_all();
+    }
+
+    // Called by a running generator between slices while `pause` is raised
+    template <class Generator>
+    void pause_task(int a1, Generator &generator) {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (!checkpointing) return;
+        generator.Frontier(published);
+        generator.flush_covers();
+        fold(a1, generator.take_stats());
+        ++paused;
+        done.notify_all();
+        resumed.wait(lock, [this]() { return !checkpointing; });
+        --paused;
+    }
 
-    int differences[MAX_C];
+    // Blocks until every task, including donated ones, has finished
+    void wait(bool print) {
+        std::unique_lock<std::mutex> lock(mutex);
+        const std::chrono::steady_clock::time_point never =
+            std::chrono::steady_clock::time_point::max();
+        std::chrono::steady_clock::time_point next =
+            checkpoint == nullptr
+                ? never
+                : std::chrono::steady_clock::now() + std::chrono::seconds(checkpoint_interval);
+        std::chrono::steady_clock::time_point report =
+            estimate.empty()
+                ? never
+                : std::chrono::steady_clock::now() + std::chrono::seconds(PROGRESS_INTERVAL);
+        while (outstanding > 0) {
+            if (print) {
+                printf("%3d\r", outstanding);
+                fflush(stdout);
+            }
+            if (next == never && report == never) {
+                done.wait(lock);
+            } else if (done.wait_until(lock, std::min(next, report)) == std::cv_status::timeout) {
+                const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+                if (now >= next) {
+                    Checkpoint(lock);
+                    next = std::chrono::steady_clock::now()
+                           + std::chrono::seconds(checkpoint_interval);
+                }
+                if (now >= report) {
+                    Progress();
+                    report = now + std::chrono::seconds(PROGRESS_INTERVAL);
+                }
+            }
+        }
+        // a finished enumeration leaves nothing to resume
+        if (checkpoint != nullptr) std::remove(checkpoint);
+    }
+
+    // Reports the share of the estimated tree searched so far, the node rate
+    // and the time left on stderr.  Each a[1] counts with its estimate
+    // until its last task finishes and with its actual size after that;
+    // the ratio of actual to estimated size over the finished ones rescales
+    // the estimates of the rest.
+    void Progress() {
+        double done_actual = 0;
+        double done_estimate = 0;
+        double open_estimate = 0;
+        for (int idx = 0; idx <= N; ++idx) {
+            if (open_by_first[idx] > 0) {
+                open_estimate += estimate[idx];
+            } else if (nodes_by_first[idx] > 0) {
+                done_actual += nodes_by_first[idx];
+                done_estimate += estimate[idx];
+            }
+        }
+        const double scale = done_estimate > 0 ? done_actual / done_estimate : 1;
+        const double nodes = progress.load(std::memory_order_relaxed);
+        const double total = std::max(base_nodes + done_actual + scale * open_estimate, nodes);
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - started;
+        const double rate = (nodes - base_nodes) / elapsed.count();
+        const double left = rate > 0 ? (total - nodes) / rate : 0;
+        const long long seconds = static_cast<long long>(left);
+        fprintf(stderr, "%5.1f%% of ~%.3g nodes, %.3g nodes/s, ETA %02lld:%02lld:%02lld\n",
+                100 * nodes / total, total, rate, seconds / 3600, seconds / 60 % 60, seconds % 60);
+    }
+
+    // Stops the running tasks at their next slice and saves the cut
+    void Checkpoint(std::unique_lock<std::mutex> &lock) {
+        checkpointing = true;
+        pause = true;
+        done.wait(lock, [this]() { return paused == running; });
+
+        if (sink != nullptr) sink->flush();
+        FILE *out = sink != nullptr ? sink->output() : stdout;
+        fflush(out);
+        CheckpointState state;
+        state.N = N;
+        state.D = D;
+        state.orbits = orbits;
+        state.output_offset = ftell(out);
+        state.found_by_first = found_by_first;
+        state.stats = stats;
+        state.frontier = published;
+        for (std::map<long long, Prefix>::const_iterator it = queued.begin(); it != queued.end();
+             ++it) {
+            state.frontier.push_back(it->second);
+        }
+        if (!WriteCheckpoint(checkpoint, state)) {
+            fprintf(stderr, "Error: cannot write checkpoint %s\n", checkpoint);
+        }
+
+        published.clear();
+        pause = false;
+        checkpointing = false;
+        resumed.notify_all();
+    }
+};
+
+constexpr long long SearchContext::PROGRESS_CHUNK;
+constexpr int SearchContext::PROGRESS_INTERVAL;
+
+template <int MaxN, int MaxD, template <int, int> class Diffs, class Dims = RuntimeDims,
+          class Profile = NoProfile>
+class DcGenerator : private Dims, private Profile {
+  private:
+    using Dims::N;
+    using Dims::D;
+    using Dims::ND;
+    using Dims::D1;
+    using Dims::N2;
+    using Dims::N1;
+
+    int a[MaxD + 1];
+    int q[MaxN + 1];
+    // int s[MaxN + 1];
+
+    Diffs<MaxN, MaxD> differences;
+    ProjectedDiffs projections;  // stepped only while `project` is set
+    bool project;
     // int count;
 
+    // One frame per open depth of the explicit search stack
+    struct Frame {
+        int p;
+        int r1;
+        int count;  // covered differences after step_forward(t)
+        int max;    // periodic child a[t + 1 - p] + a[p]
+        int next;   // children a[t + 1] still to try run from next down to stop
+        int stop;
+    };
+    Frame frames[MaxD + 1];
+    // Last elements a[D - 1] that can complete the open frame at depth D - 2
+    uint64_t leaves[(MaxN + 63) / 64];
+    int base;  // depth of the subtree root
+    int top;   // deepest open frame, base - 1 once exhausted
+
+    bool print;
+    CoverSink::Buffer covers;
+    SearchStats stats;
+    SearchContext *ctx;
+    unsigned bounds;
+    bool by_orbit;  // report only covers leading their affine orbit
+    AffineOrbits<MaxD> orbits;
+
   public:
-    DcGenerator(int n, int d, int j)
-        : N(n), D(d), ND(N - D), N2(N / 2), D1(D - 1), N1(N2 - D * D1 / 2) {
+    DcGenerator(int n, int d, int j, bool print = true, SearchContext *ctx = nullptr)
+        : Dims(n, d),
+          Profile(),
+          print(print),
+          covers(ctx != nullptr ? ctx->sink : nullptr),
+          ctx(ctx),
+          bounds(ctx != nullptr ? ctx->bounds : DEFAULT_BOUNDS),
+          by_orbit(ctx != nullptr && ctx->orbits) {
         // Initialize arrays to zero
         std::memset(a, 0, sizeof(a));
         std::memset(q, 0, sizeof(q));
         // std::memset(s, 0, sizeof(s));
-        std::memset(differences, 0, sizeof(differences));
+        differences.init(N);
+        projections.init(N, D, (bounds & (1u << BOUND_DIVISORS)) != 0);
+        project = !projections.empty();
 
         a[D] = N;  // for generating bracelets
         a[0] = 0;  // for computing difference cover
@@ -90,7 +728,55 @@ class DcGenerator {
 
         a[1] = j;
         q[j] = 1;
-        differences[0] = 1;
+
+        if (by_orbit) orbits.init(N, D);
+    }
+
+    DcGenerator(int n, int d, const Prefix &prefix, bool print, SearchContext *ctx)
+        : DcGenerator(n, d, prefix.a[0], print, ctx) {
+        for (int idx = 2; idx <= prefix.t; ++idx) {
+            a[idx] = prefix.a[idx - 1];
+            q[a[idx]] = 1;
+        }
+    }
+
+    long long num_found() const { return stats.found; }
+
+    const SearchStats &search_stats() const { return stats; }
+
+    // Hands the covers found so far to the sink
+    void flush_covers() { covers.flush(); }
+
+    // Counters since the last call, for a checkpoint to fold in
+    SearchStats take_stats() {
+        const SearchStats taken = stats;
+        stats = SearchStats();
+        return taken;
+    }
+
+    // Runs the subtree of a prefix built by the constructor above.  With
+    // checkpoints on it searches in slices so that a pending checkpoint can
+    // collect its frontier.
+    void Resume(const Prefix &prefix) {
+        Start(prefix);
+        if (ctx == nullptr || ctx->checkpoint == nullptr) {
+            Search();
+        } else {
+            while (!Search(1 << 16)) {
+                if (ctx->pause.load(std::memory_order_relaxed)) ctx->pause_task(prefix.a[0], *this);
+            }
+        }
+        Profile::finish(prefix.a.data(), prefix.t);
+    }
+
+    // Gives the lower half of the remaining children of frame t to the pool
+    void Donate(int t) {
+        Frame &f = frames[t];
+        const int half = (f.next - f.stop + 1) / 2;
+        Prefix prefix{t, f.p, f.r1, std::vector<int>(a + 1, a + t + 1), f.stop + half - 1, f.stop};
+        f.stop += half;
+
+        ctx->submit<DcGenerator>(print, prefix);
     }
 
     int CheckRev(int t_1) {
@@ -101,37 +787,43 @@ class DcGenerator {
         return 0;
     }
 
-    inline void step_forward(int t, int &count) {
-        const int at = a[t];
-        for (int idx = 0; idx < t; ++idx) {
-            const int aj = a[idx];
-            const int p_diff = at - aj;
-            const int n_diff = N - p_diff;
-            const int diff = p_diff < n_diff ? p_diff : n_diff;
+    inline bool cancelled() const {
+        return ctx != nullptr && ctx->cancelled.load(std::memory_order_relaxed);
+    }
 
-            // Note that p_diff may be equal to n_diff
-            if (differences[diff]++ == 0) {
-                ++count;
-            }
-        }
+    // A valid leaf is reported unless another generator already claimed the
+    // single cover wanted in find-first mode
+    inline bool Claim() {
+        return ctx == nullptr || !ctx->first || !ctx->cancelled.exchange(true);
     }
 
-    inline void step_backward(int t) {
-        const int at = a[t];
-        for (int idx = 0; idx < t; ++idx) {
-            const int aj = a[idx];
-            const int p_diff = at - aj;
-            const int n_diff = N - p_diff;
-            const int diff = p_diff < n_diff ? p_diff : n_diff;
-            --differences[diff];
-            // Note that p_diff may be equal to n_diff
-            // if (--differences[diff] == 0) {
-            //     --count;
-            // }
-        }
+    // The leaf a[0..D-1] is reported only if its class leads its orbit
+    inline bool Leader() {
+        if (!by_orbit || orbits.leader(a)) return true;
+        ++stats.non_leaders;
+        return false;
+    }
+
+    // With --orbits, a node none of whose leaves can lead its orbit is cut
+    // and counted with the non-leaders.  The nodes at depth D - 2 are left
+    // to the leaf check, which BatchLeaves makes cheaper than the test.
+    inline bool MayLead(int t) {
+        if (!by_orbit || t + 1 >= D1 || !orbits.beaten(a, t)) return true;
+        ++stats.non_leaders;
+        return false;
+    }
+
+    DC_INLINE void step_forward(int t, int &count) {
+        differences.step_forward(a, t, N, count);
+        if (project) projections.step_forward(a, t);
+    }
+
+    DC_INLINE void step_backward(int t) {
+        differences.step_backward(a, t, N);
+        if (project) projections.step_backward(t);
     }
 
-    void PrintD(int p, int count) {
+    DC_INLINE void PrintD(int p) {
         /* Determine minimum position for next bit */
         const int Dp = D % p;
         const int next = (D / p) * a[p] + a[Dp];
@@ -145,167 +837,1233 @@ class DcGenerator {
         if (min != 1) return;
 
         // if (min == 1) {
-        step_forward(D1, count);
-        if (count >= N2) {
-            printf("\n");
-            for (int idx = 1; idx <= D; ++idx) {
-                printf("%3d ", a[idx]);
-            }
-            printf("\n");
-            fflush(stdout);
+        // a[D1] passed BatchLeaves(), so every difference is covered
+        if (Leader() && Claim()) {
+            ++stats.found;
+            if (print) covers.put(a + 1, D);
         }
-        step_backward(D1);
         // }
     }
 
-    void BraceFD(int t, int p, int r1, int count) {
+    // Checks the enabled bounds on the node a[0..t] with `count` differences
+    DC_INLINE bool Feasible(int t, int count) {
+        const int t_1 = t + 1;
+        // every pair left to form covers a new difference
+        if ((bounds & (1u << BOUND_PAIRS)) && count < N1 + t * t_1 / 2) {
+            ++stats.cuts[BOUND_PAIRS];
+            return false;
+        }
+        if ((bounds & (1u << BOUND_LOOKAHEAD)) && !LookAhead(t, count)) {
+            ++stats.cuts[BOUND_LOOKAHEAD];
+            return false;
+        }
+        if (project && !projections.feasible(D1 - t)) {
+            ++stats.cuts[BOUND_DIVISORS];
+            return false;
+        }
+        return true;
+    }
+
+    // The r = D-1-t elements still to place lie in (a[t], N - 1] (the tail
+    // limits), so a pair of them differs by at most span = N - 2 - a[t] and
+    // can only cover folded differences in [1, span] or [N - span, N/2].
+    // At most min(open ones there, r(r-1)/2) differences come from such
+    // pairs and at most (t+1)r from pairs with a[0..t].
+    DC_INLINE bool LookAhead(int t, int count) {
+        const int r = D1 - t;
+        const int span = N - 2 - a[t];
+        int reach = 0;
+        if (span >= 1) {
+            const int low = span < N2 ? span : N2;
+            reach = low - differences.covered_in(1, low);
+            const int high = N - span > low + 1 ? N - span : low + 1;
+            if (high <= N2) reach += N2 - high + 1 - differences.covered_in(high, N2);
+        }
+        const int among = r * (r - 1) / 2;
+        const int gain = (reach < among ? reach : among) + (t + 1) * r;
+        return count + gain >= N2;
+    }
+
+    // Opens the node at depth t: steps its element forward and pushes a
+    // frame, or reports a leaf / pruned node by returning false.
+    DC_INLINE bool Enter(int t, int p, int r1, int count) {
         if (t >= D1) {
-            PrintD(p, count);
-            return;
+            Profile::leaf(t);
+            PrintD(p);
+            return false;
         }
 
-        const int at = a[t];
-        // if (at > (N - r1 + 1) / 2 + r1 - 1) {
-        //     int e = N - at + r1;
-        //     if (q[at] > q[e]) RS = false;
-        //     else if (q[at] < q[e]) RS = true;
-        //     else if (at - a[t - 1] > a[s[e] + 1] - a[s[e]]) {
-        //         RS = true;
-        //     }
-        // }
+        step_forward(t, count);
+        if ((++stats.nodes & (SearchContext::PROGRESS_CHUNK - 1)) == 0 && ctx != nullptr) {
+            ctx->progress.fetch_add(SearchContext::PROGRESS_CHUNK, std::memory_order_relaxed);
+        }
+        Profile::enter(t);
+        if (!Feasible(t, count) || !MayLead(t)) {
+            Profile::prune(t);
+            step_backward(t);
+            return false;
+        }
+        Open(t, p, r1, count);
+        return true;
+    }
 
+    // Pushes the frame of the node at depth t, whose element is stepped
+    // forward with `count` differences covered
+    DC_INLINE void Open(int t, int p, int r1, int count) {
         const int t_1 = t + 1;
-        step_forward(t, count);
+        Frame &f = frames[t];
+        f.p = p;
+        f.r1 = r1;
+        f.count = count;
+        f.max = a[t_1 - p] + a[p];
+        f.next = f.max < ND + t_1 ? f.max : ND + t_1;
+        f.stop = a[t] + 1;
+        if (t_1 == D1) BatchLeaves(t, count);
+    }
 
-        if (count >= N1 + t * t_1 / 2) {
-            int tail = ND + t_1;
-            const int max = a[t_1 - p] + a[p];
+    // At depth D - 2 the uncovered differences are known, so the last
+    // element x must realize each of them as x - a[idx] or N - x + a[idx]:
+    // the valid x are the intersection over uncovered u of the chosen set
+    // shifted up by u and by N - u.  Search() visits only those children, and
+    // PrintD() needs no step for them.
+    DC_INLINE void BatchLeaves(int t, int count) {
+        static constexpr int W = (MaxN + 63) / 64;
+        const int words = (N - 1) / 64 + 1;
+        // the last element brings t + 1 new pairs
+        if (N2 - count > t + 1) {
+            for (int idx = 0; idx < words; ++idx) leaves[idx] = 0;
+            return;
+        }
+        uint64_t chosen[W] = {};
+        for (int idx = 0; idx <= t; ++idx) chosen[a[idx] >> 6] |= uint64_t(1) << (a[idx] & 63);
+        for (int idx = 0; idx < words; ++idx) leaves[idx] = ~uint64_t(0);
+        if ((N & 63) != 0) leaves[words - 1] = (uint64_t(1) << (N & 63)) - 1;
 
-            if (max <= tail) {
-                int r2 = r1;
-                // bool RS2 = RS;
-                a[t_1] = max;
-                q[max] = q[a[t_1 - p]];
-                // s[max] = t_1;
-                if (a[1] == max - at) {
-                    int rev = CheckRev(max);
-                    if (rev == 0) {
-                        r2 = max;
-                        // RS2 = false;
-                    }
-                    if (rev != -1) {
-                        BraceFD(t_1, p, r2, count);
+        int open[MaxD];
+        const int num = N2 - count;
+        differences.uncovered(N, num, open);
+        for (int u = 0; u < num; ++u) {
+            const int up = open[u];
+            const int down = N - open[u];
+            for (int idx = 0; idx < words; ++idx) {
+                leaves[idx] &= shl_word(chosen, up, idx) | shl_word(chosen, down, idx);
+            }
+        }
+    }
+
+    // Word idx of (src << k) for src of N bits
+    static DC_INLINE uint64_t shl_word(const uint64_t *src, int k, int idx) {
+        const int j = idx - (k >> 6);
+        const int bs = k & 63;
+        if (j < 0) return 0;
+        uint64_t w = src[j] << bs;
+        if (bs != 0 && j > 0) w |= src[j - 1] >> (64 - bs);
+        return w;
+    }
+
+    // Largest candidate last element <= v, or -1
+    DC_INLINE int NextLeaf(int v) const {
+        for (int idx = v >> 6; idx >= 0; --idx) {
+            uint64_t word = leaves[idx];
+            if (idx == v >> 6 && (v & 63) != 63) word &= (uint64_t(2) << (v & 63)) - 1;
+            if (word != 0) return 64 * idx + 63 - __builtin_clzll(word);
+        }
+        return -1;
+    }
+
+    // Opens the subtree of a prefix built by the Prefix constructor.  A
+    // prefix with a child range is a frame some search already entered
+    // (donated or saved in a checkpoint), so it is reopened without being
+    // counted, checked or profiled again.
+    void Start(const Prefix &prefix) {
+        int count = 0;
+        for (int idx = 1; idx < prefix.t; ++idx) step_forward(idx, count);
+        base = prefix.t;
+        top = base - 1;
+        if (prefix.hi < 0) {
+            if (Enter(prefix.t, prefix.p, prefix.r1, count)) top = base;
+            return;
+        }
+        step_forward(prefix.t, count);
+        Open(prefix.t, prefix.p, prefix.r1, count);
+        frames[base].next = prefix.hi;
+        frames[base].stop = prefix.lo;
+        top = base;
+    }
+
+    // Explores the open subtree in the same order as the recursive BraceFD.
+    // Returns true once it is exhausted, or false after `budget` children
+    // have been tried, with the frames intact so that a later call resumes.
+    DC_MULTIVERSION bool Search(long long budget = -1) {
+        int t = top;
+        while (t >= base) {
+            if (cancelled()) {
+                top = base - 1;
+                return true;
+            }
+            Frame &f = frames[t];
+            if (f.next < f.stop) {
+                step_backward(t);
+                if (t > base) q[a[t]] = 0;
+                --t;
+                continue;
+            }
+            if (t == D1 - 1) {
+                f.next = NextLeaf(f.next);
+                if (f.next < f.stop) continue;
+            }
+            if (budget >= 0 && budget-- == 0) {
+                top = t;
+                return false;
+            }
+            if (ctx != nullptr && t < ctx->split_depth && f.next > f.stop && ctx->pool.idle() > 0) {
+                Donate(t);
+            }
+
+            const int t_1 = t + 1;
+            const int v = f.next--;
+            int p = t_1;
+            int r1 = f.r1;
+            a[t_1] = v;
+            if (v == f.max) {
+                p = f.p;
+                q[v] = q[a[t_1 - p]];
+                if (a[1] == v - a[t]) {
+                    const int rev = CheckRev(v);
+                    if (rev == 0) r1 = v;
+                    if (rev == -1) {
+                        q[v] = 0;
+                        continue;
                     }
-                } else {
-                    BraceFD(t_1, p, r1, count);
                 }
-                q[max] = 0;
-                // s[max] = 0;
-                tail = max - 1;
+            } else {
+                q[v] = 1;
             }
-            for (int idx = tail; idx >= at + 1; --idx) {
-                a[t_1] = idx;
-                // s[idx] = t_1;
-                q[idx] = 1;
-                BraceFD(t_1, t_1, r1, count);
-                q[idx] = 0;
-                // s[idx] = 0;
+            if (Enter(t_1, p, r1, f.count)) {
+                t = t_1;
+            } else {
+                q[v] = 0;
             }
         }
-        step_backward(t);
+        top = t;
+        return true;
+    }
+
+    // Appends the untried children of every open frame, which together
+    // with the finished work cover the whole subtree
+    void Frontier(std::vector<Prefix> &frontier) const {
+        for (int t = base; t <= top; ++t) {
+            const Frame &f = frames[t];
+            if (f.next < f.stop) continue;
+            frontier.push_back(
+                Prefix{t, f.p, f.r1, std::vector<int>(a + 1, a + t + 1), f.next, f.stop});
+        }
     }
 
     void BraceFD11() {
-        const int a1 = a[1];
-        const int r1 = a1;
-        // const bool RS = false;
+        Start(Prefix{1, 1, a[1], std::vector<int>(1, a[1]), -1, 0});
+        Search();
+    }
 
-        // if (0 > (N - r) / 2 - 1) {
-        //     printf("Boom!!!\n");
-        //     exit(1);
-        // }
+    // Knuth's estimator of the number of nodes Search() enters below a
+    // prefix: a probe walks down a uniformly random child at every node,
+    // and 1 + d1 + d1 d2 + ..., with d_k the number of children of the
+    // k-th node on the path, is an unbiased estimate of the subtree size.
+    // Returns the mean over `probes` paths.  The children are the ones
+    // Search() would enter (CheckRev cuts excluded); the leaves below depth
+    // D - 2 are not counted, like in `stats.nodes`.
+    double Estimate(const Prefix &prefix, int probes, std::mt19937_64 &rng) {
+        Start(prefix);
+        if (top < base) return 1;
+        int children[MaxN];
+        double sum = 0;
+        for (int probe = 0; probe < probes; ++probe) {
+            double size = 1;
+            double weight = 1;
+            int t = base;
+            while (t < D1 - 1) {
+                const Frame &f = frames[t];
+                int num = 0;
+                for (int v = f.next; v >= f.stop; --v) {
+                    if (v == f.max && a[1] == v - a[t] && CheckRev(v) == -1) continue;
+                    children[num++] = v;
+                }
+                if (num == 0) break;
+                weight *= num;
+                size += weight;
 
-        int count = 0;
-        step_forward(1, count);
-        int tail = ND + 2;
-        const int max = a1 + a1;
-        if (max <= tail) {
-            int r2 = r1;
-            // bool RS2 = RS;
-            a[2] = max;
-            q[max] = q[a1];
-            // s[max] = 2;
-            if (a1 == max - a1) {
-                // if (CheckRev(max) != 0) {
-                //     printf("Boom2!!!\n");
-                //     exit(2);
-                // }
-                r2 = max;
-                // RS2 = false;
-                BraceFD(2, 1, r2, count);
-            } else {
-                BraceFD(2, 1, r1, count);
+                const int t_1 = t + 1;
+                const int v = children[rng() % num];
+                int p = t_1;
+                int r1 = f.r1;
+                a[t_1] = v;
+                q[v] = 1;
+                if (v == f.max) {
+                    p = f.p;
+                    q[v] = q[a[t_1 - p]];
+                    if (a[1] == v - a[t] && CheckRev(v) == 0) r1 = v;
+                }
+                if (!Enter(t_1, p, r1, f.count)) {
+                    q[v] = 0;
+                    break;
+                }
+                t = t_1;
+            }
+            sum += size;
+            for (; t > base; --t) {
+                step_backward(t);
+                q[a[t]] = 0;
             }
-            q[max] = 0;
-            // s[max] = 0;
-            tail = max - 1;
         }
+        return sum / probes;
+    }
+};
 
-        for (int idx = tail; idx >= a1 + 1; --idx) {
-            a[2] = idx;
-            // s[idx] = 2;
-            q[idx] = 1;
-            BraceFD(2, 2, r1, count);
-            q[idx] = 0;
-            // s[idx] = 0;
+// Difference-driven search.  Instead of placing positions in increasing
+// order it repeatedly takes the uncovered difference u with the fewest
+// candidates, the free positions x that can still realize it (x + u or
+// x - u chosen, or also free while at least two elements remain), and
+// branches on which candidate is the first one in the cover, excluding the
+// earlier ones.  Every cover contains a candidate for each of its
+// differences, so each cover is reached exactly once.  Sets are normalized
+// like the bracelet search: a[0] = 0 and a[1] = g the largest gap, so 1..g-1
+// start excluded and no run of g excluded positions may appear.  A leaf is
+// reported only if DcGenerator would reach and print it, which Accepted()
+// decides by replaying that generator's choices along a[], so both engines
+// report the same covers in the same form.
+template <int MaxN, int MaxD>
+class DifferenceDriven {
+  private:
+    static constexpr int W = (MaxN + 63) / 64;
+
+    const int N;
+    const int D;
+    const int N2;
+    const int g;  // a[1], the largest gap
+
+    int elems[MaxD];  // chosen positions, in the order they were added
+    int num;
+    uint64_t in[W];
+    uint64_t out[W];
+    uint64_t full[W];             // bits 0..N-1
+    int support[MaxN / 2 + 1];    // pairs realizing each folded difference
+    int uncovered;                // differences 1..N/2 with no support
+
+    bool print;
+    CoverSink::Buffer covers;
+    SearchStats stats;
+    SearchContext *ctx;
+    bool by_orbit;
+    AffineOrbits<MaxD> orbits;
+
+    static inline bool test(const uint64_t *s, int b) { return (s[b >> 6] >> (b & 63)) & 1; }
+
+    // Word idx of the N-bit set src rotated up by k, 0 < k < N
+    inline uint64_t rotated_word(const uint64_t *src, int k, int idx) const {
+        uint64_t w = 0;
+        // bits b >= k come from b - k
+        const int ws = k >> 6, bs = k & 63;
+        const int j = idx - ws;
+        if (j >= 0) {
+            w = src[j] << bs;
+            if (bs != 0 && j > 0) w |= src[j - 1] >> (64 - bs);
+        }
+        // bits b < k come from b + N - k
+        const int r = N - k;
+        const int rws = r >> 6, rbs = r & 63;
+        const int i = idx + rws;
+        if (i < W) {
+            uint64_t v = src[i] >> rbs;
+            if (rbs != 0 && i + 1 < W) v |= src[i + 1] << (64 - rbs);
+            w |= v;
         }
-        // step_backward(1);
+        return w & full[idx];
     }
 
-    static void usage() { printf("Usage: necklace [n] [d] (n>=3, d>=3, n<=d*(d-1)+1)\n"); }
+    void Include(int x) {
+        for (int idx = 0; idx < num; ++idx) {
+            const int p_diff = x > elems[idx] ? x - elems[idx] : elems[idx] - x;
+            const int diff = p_diff < N - p_diff ? p_diff : N - p_diff;
+            if (support[diff]++ == 0) --uncovered;
+        }
+        elems[num++] = x;
+        in[x >> 6] |= uint64_t(1) << (x & 63);
+    }
+
+    void Remove(int x) {
+        in[x >> 6] &= ~(uint64_t(1) << (x & 63));
+        --num;
+        for (int idx = 0; idx < num; ++idx) {
+            const int p_diff = x > elems[idx] ? x - elems[idx] : elems[idx] - x;
+            const int diff = p_diff < N - p_diff ? p_diff : N - p_diff;
+            if (--support[diff] == 0) ++uncovered;
+        }
+    }
+
+    // Whether excluding x closed a run of g excluded positions, a gap > g
+    bool GapTooLong(int x) const {
+        int run = 1;
+        for (int y = x + 1 == N ? 0 : x + 1; test(out, y) && run < g; y = y + 1 == N ? 0 : y + 1) {
+            ++run;
+        }
+        for (int y = x == 0 ? N - 1 : x - 1; test(out, y) && run < g; y = y == 0 ? N - 1 : y - 1) {
+            ++run;
+        }
+        return run >= g;
+    }
+
+    inline bool cancelled() const {
+        return ctx != nullptr && ctx->cancelled.load(std::memory_order_relaxed);
+    }
+
+    // Follows DcGenerator::Search and PrintD down the path a[1..D-1]: the
+    // periodic bound on each child, the CheckRev cut and the final
+    // necklace test
+    bool Accepted(const int *a) const {
+        int q[MaxN + 1] = {};
+        q[a[1]] = 1;
+        int p = 1;
+        for (int t = 1; t + 1 < D; ++t) {
+            const int t_1 = t + 1;
+            const int v = a[t_1];
+            const int max = a[t_1 - p] + a[p];
+            if (v > max) return false;
+            q[v] = 1;
+            if (v < max) {
+                p = t_1;
+            } else if (a[1] == v - a[t]) {
+                // CheckRev(v)
+                for (int idx = a[1]; idx <= v / 2; ++idx) {
+                    if (q[idx] < q[v - idx]) break;
+                    if (q[idx] > q[v - idx]) return false;
+                }
+            }
+        }
+        const int Dp = D % p;
+        const int next = (D / p) * a[p] + a[Dp];
+        return next > N || (next == N && Dp == 0);
+    }
+
+    void Leaf() {
+        int a[MaxD + 1];
+        std::copy(elems, elems + D, a);
+        std::sort(a, a + D);
+        a[D] = N;
+        if (!Accepted(a)) return;
+        if (by_orbit && !orbits.leader(a)) {
+            ++stats.non_leaders;
+            return;
+        }
+        if (ctx != nullptr && ctx->first && ctx->cancelled.exchange(true)) return;
+        ++stats.found;
+        if (print) covers.put(a + 1, D);
+    }
+
+    // Picks the positions to branch on at an inner node into best[];
+    // false if the node is cut
+    bool Branch(uint64_t *best) {
+        const int r = D - num;
+        // every pair left to form covers a new difference
+        if (uncovered > r * num + r * (r - 1) / 2) return false;
+
+        uint64_t free[W];
+        int num_free = 0;
+        for (int idx = 0; idx < W; ++idx) {
+            free[idx] = full[idx] & ~in[idx] & ~out[idx];
+            num_free += __builtin_popcountll(free[idx]);
+        }
+        if (num_free < r) return false;
+
+        // Branch on the candidates of the most constrained difference, or
+        // on any free position once everything is covered
+        std::memcpy(best, free, sizeof(uint64_t) * W);
+        if (uncovered > 0) {
+            uint64_t partners[W];  // positions a candidate may pair with
+            for (int idx = 0; idx < W; ++idx) {
+                partners[idx] = r == 1 ? in[idx] : in[idx] | free[idx];
+            }
+            int best_size = num_free + 1;
+            for (int u = 1; u <= N2 && best_size > 1; ++u) {
+                if (support[u] != 0) continue;
+                uint64_t cand[W];
+                int size = 0;
+                for (int idx = 0; idx < W; ++idx) {
+                    cand[idx] = free[idx]
+                                & (rotated_word(partners, u, idx)
+                                   | rotated_word(partners, N - u, idx));
+                    size += __builtin_popcountll(cand[idx]);
+                }
+                if (size == 0) return false;
+                if (size < best_size) {
+                    best_size = size;
+                    std::memcpy(best, cand, sizeof(cand));
+                }
+            }
+        }
+        return true;
+    }
+
+    void Search() {
+        if (cancelled()) return;
+        if ((++stats.nodes & (SearchContext::PROGRESS_CHUNK - 1)) == 0 && ctx != nullptr) {
+            ctx->progress.fetch_add(SearchContext::PROGRESS_CHUNK, std::memory_order_relaxed);
+        }
+        if (num == D) {
+            if (uncovered == 0) Leaf();
+            return;
+        }
+        uint64_t best[W];
+        if (!Branch(best)) return;
+
+        uint64_t saved[W];
+        std::memcpy(saved, out, sizeof(saved));
+        for (int idx = 0; idx < W; ++idx) {
+            for (uint64_t rest = best[idx]; rest != 0; rest &= rest - 1) {
+                const int x = 64 * idx + __builtin_ctzll(rest);
+                Include(x);
+                Search();
+                Remove(x);
+                // later branches leave x out
+                out[idx] |= uint64_t(1) << (x & 63);
+                if (GapTooLong(x)) goto done;
+            }
+        }
+    done:
+        std::memcpy(out, saved, sizeof(saved));
+    }
+
+  public:
+    DifferenceDriven(int n, int d, const Prefix &prefix, bool print, SearchContext *ctx)
+        : N(n),
+          D(d),
+          N2(n / 2),
+          g(prefix.a[0]),
+          num(0),
+          uncovered(n / 2),
+          print(print),
+          covers(ctx != nullptr ? ctx->sink : nullptr),
+          ctx(ctx),
+          by_orbit(ctx != nullptr && ctx->orbits) {
+        std::memset(in, 0, sizeof(in));
+        std::memset(out, 0, sizeof(out));
+        std::memset(full, 0, sizeof(full));
+        std::memset(support, 0, sizeof(support));
+        for (int x = 0; x < N; ++x) full[x >> 6] |= uint64_t(1) << (x & 63);
+        for (int x = 1; x < g; ++x) out[x >> 6] |= uint64_t(1) << (x & 63);
+        if (by_orbit) orbits.init(N, D);
+    }
+
+    const SearchStats &search_stats() const { return stats; }
+
+    void flush_covers() { covers.flush(); }
+
+    // Searches every cover with a[1] = g; only whole a[1] prefixes are
+    // submitted for this engine
+    void Resume(const Prefix & /* prefix */) {
+        Include(0);
+        Include(g);
+        Search();
+    }
+
+    // Knuth's estimator of the nodes Search() enters for a[1] = g, as in
+    // DcGenerator::Estimate.  The children of a node are its candidates up
+    // to the one whose exclusion closes a gap longer than g.
+    double Estimate(const Prefix & /* prefix */, int probes, std::mt19937_64 &rng) {
+        Include(0);
+        Include(g);
+        uint64_t root[W];
+        std::memcpy(root, out, sizeof(root));
+        int children[MaxN];
+        int path[MaxD];
+        double sum = 0;
+        for (int probe = 0; probe < probes; ++probe) {
+            double size = 1;
+            double weight = 1;
+            int depth = 0;
+            uint64_t best[W];
+            while (num < D && Branch(best)) {
+                int k = 0;
+                uint64_t saved[W];
+                std::memcpy(saved, out, sizeof(saved));
+                bool closed = false;
+                for (int idx = 0; idx < W && !closed; ++idx) {
+                    for (uint64_t rest = best[idx]; rest != 0 && !closed; rest &= rest - 1) {
+                        const int x = 64 * idx + __builtin_ctzll(rest);
+                        children[k++] = x;
+                        out[idx] |= uint64_t(1) << (x & 63);
+                        closed = GapTooLong(x);
+                    }
+                }
+                std::memcpy(out, saved, sizeof(saved));
+                weight *= k;
+                size += weight;
+
+                const int pick = rng() % k;
+                for (int idx = 0; idx < pick; ++idx) {
+                    out[children[idx] >> 6] |= uint64_t(1) << (children[idx] & 63);
+                }
+                Include(children[pick]);
+                path[depth++] = children[pick];
+            }
+            sum += size;
+            while (depth > 0) Remove(path[--depth]);
+            std::memcpy(out, root, sizeof(root));
+        }
+        return sum / probes;
+    }
 };
 
-void InitParallel(int N, int D) {
-    const unsigned num_workers = std::thread::hardware_concurrency();
-    ThreadPool pool(num_workers);
-    printf("Number of workers: %u\n", num_workers / 2);
+// Drops the covers printed after the checkpoint was taken, when the output
+// is a file (append to stdout with >> when resuming)
+static void RewindOutput(FILE *out, long long offset) {
+    struct stat st;
+    if (offset < 0 || fstat(fileno(out), &st) != 0 || !S_ISREG(st.st_mode) || st.st_size < offset) {
+        return;
+    }
+    if (ftruncate(fileno(out), offset) == 0) fseek(out, 0, SEEK_END);
+}
+
+// Prints the --count and --stats summaries of a finished enumeration
+static void Report(int N, int D, const Options &opts, const std::vector<long long> &found_by_first,
+                   const SearchStats &stats) {
+    if (opts.count) {
+        for (int idx = (N + 1) / 2; idx >= (N - 1) / D + 1; --idx) {
+            printf("a[1]=%3d: %lld\n", idx, found_by_first[idx]);
+        }
+        printf("total: %lld\n", stats.found);
+    }
+    if (opts.stats) {
+        printf("nodes: %lld\n", stats.nodes);
+        // The difference-driven engine applies none of the bounds
+        for (int idx = 0; idx < NUM_BOUNDS && opts.engine != Engine::Driven; ++idx) {
+            if (opts.bounds & (1u << idx)) {
+                printf("cut by %-9s %lld\n", bound_names[idx], stats.cuts[idx]);
+            }
+        }
+        if (opts.orbits) printf("non-leaders: %lld\n", stats.non_leaders);
+    }
+}
+
+// Prints the hardware counters of each a[1] subtree and their sum (--perf);
+// a counter the machine does not provide shows as n/a
+static void ReportPerf(int N, int D, const std::vector<PerfSample> &perf_by_first) {
+    const auto row = [](const char *label, const PerfSample &sample) {
+        printf("%-8s", label);
+        for (int event = 0; event < NUM_PERF_EVENTS; ++event) {
+            if (sample.value[event] < 0) {
+                printf(" %15s", "n/a");
+            } else {
+                printf(" %15lld", sample.value[event]);
+            }
+        }
+        const long long cycles = sample.value[PERF_CYCLES];
+        const long long instructions = sample.value[PERF_INSTRUCTIONS];
+        if (cycles > 0 && instructions >= 0) {
+            printf(" %6.2f\n", static_cast<double>(instructions) / cycles);
+        } else {
+            printf(" %6s\n", "n/a");
+        }
+    };
+    printf("%-8s", "a[1]");
+    for (int event = 0; event < NUM_PERF_EVENTS; ++event) printf(" %15s", perf_names[event]);
+    printf(" %6s\n", "IPC");
+    PerfSample total;
+    for (int idx = (N + 1) / 2; idx >= (N - 1) / D + 1; --idx) {
+        row(std::to_string(idx).c_str(), perf_by_first[idx]);
+        total.add(perf_by_first[idx]);
+    }
+    row("total", total);
+}
+
+// Probes per a[1] for ordering by --lpt when no estimate or costs are given
+static constexpr int LPT_PROBES = 200;
+
+// Knuth estimates of the a[1] subtrees, seeded by a[1] so runs agree
+template <class Generator>
+std::vector<double> EstimateFirst(SearchContext &ctx, int N, int D, int probes) {
+    std::vector<double> estimate(N + 1, 0);
+    for (int idx = (N + 1) / 2; idx >= (N - 1) / D + 1; --idx) {
+        const Prefix prefix{1, 1, idx, std::vector<int>(1, idx), -1, 0};
+        std::mt19937_64 rng(idx);
+        Generator generator(N, D, prefix, false, &ctx);
+        estimate[idx] = generator.Estimate(prefix, probes, rng);
+    }
+    ctx.progress = 0;
+    return estimate;
+}
+
+template <class Generator>
+long long RunParallel(int N, int D, const Options &opts) {
+    const bool print = opts.print;
+    CheckpointState state;
+    if (opts.resume) {
+        if (!ReadCheckpoint(opts.checkpoint, N, D, state) || state.orbits != opts.orbits) {
+            fprintf(stderr, "Error: %s is no checkpoint of this run\n", opts.checkpoint);
+            exit(1);
+        }
+    }
+
+    ThreadPool pool;
+    if (print) printf("Number of workers: %zu\n", pool.size());
 
-    std::vector<std::future<void>> results;
-    results.reserve((N + 1) / 2 - (N - 1) / D);  // Pre-allocate space
+    // By default children this close to the leaves are too small to be worth a task
+    SearchContext ctx(pool, opts, opts.split_depth >= 0 ? opts.split_depth : D - 4, N, D);
 
     const int start = (N + 1) / 2;
     const int end = (N - 1) / D + 1;
 
-    for (int idx = start; idx >= end; --idx) {
-        results.emplace_back(pool.enqueue([N, D, idx]() {
-            DcGenerator generator(N, D, idx);
-            generator.BraceFD11();
-        }));
+    if (opts.estimate > 0) {
+        // the whole report is the output of --estimate-only
+        FILE *report = opts.estimate_only ? stdout : stderr;
+        ctx.estimate = EstimateFirst<Generator>(ctx, N, D, opts.estimate);
+        double total = 0;
+        for (int idx = start; idx >= end; --idx) {
+            total += ctx.estimate[idx];
+            fprintf(report, "a[1]=%3d: ~%.3g nodes\n", idx, ctx.estimate[idx]);
+        }
+        fprintf(report, "estimated total: ~%.3g nodes\n", total);
+        if (opts.estimate_only) return 0;
+    }
+
+    // Longest subtree first (--lpt): by the nodes of an earlier run if the
+    // costs file has them, else by a quick estimate.  Resumed prefixes are
+    // ranked by their a[1].  Without it the cost is -1 and tasks start in
+    // submission order.
+    std::vector<double> cost(N + 1, -1);
+    if (opts.lpt && (opts.costs == nullptr || !ReadCosts(opts.costs, N, D, cost))) {
+        cost = ctx.estimate.empty() ? EstimateFirst<Generator>(ctx, N, D, LPT_PROBES)
+                                    : ctx.estimate;
+    }
+
+    // Covers go to --output or stdout through the sink; a resumed run
+    // appends to what the checkpoint saw of it
+    std::unique_ptr<FILE, int (*)(FILE *)> file(
+        opts.output != nullptr ? fopen(opts.output, opts.resume ? "ab" : "wb") : nullptr, fclose);
+    if (opts.output != nullptr && file == nullptr) {
+        fprintf(stderr, "Error: cannot write %s\n", opts.output);
+        exit(1);
+    }
+    FILE *out = file != nullptr ? file.get() : stdout;
+    if (opts.resume) RewindOutput(out, state.output_offset);
+    CoverSink sink(out, opts.format, N, D);
+    ctx.sink = &sink;
+
+    if (opts.resume) {
+        for (int idx = 0; idx <= N; ++idx) ctx.found_by_first[idx] = state.found_by_first[idx];
+        ctx.found = state.stats.found;
+        ctx.stats = state.stats;
+        ctx.base_nodes = state.stats.nodes;
+        ctx.progress = state.stats.nodes;
+        for (size_t idx = 0; idx < state.frontier.size(); ++idx) {
+            ctx.submit<Generator>(print, state.frontier[idx], cost[state.frontier[idx].a[0]]);
+        }
+    } else {
+        for (int idx = start; idx >= end; --idx) {
+            ctx.submit<Generator>(print, Prefix{1, 1, idx, std::vector<int>(1, idx), -1, 0},
+                                  cost[idx]);
+        }
+    }
+    ctx.wait(print);
+    sink.flush();
+    // only a complete run has the node count of every a[1]
+    if (opts.costs != nullptr && !opts.resume && !opts.first
+        && !WriteCosts(opts.costs, N, D, ctx.nodes_by_first)) {
+        fprintf(stderr, "Error: cannot write costs %s\n", opts.costs);
+    }
+    if (print) printf("\n");
+    if (opts.first && ctx.found == 0) printf("No cover exists for N=%d D=%d\n", N, D);
+    Report(N, D, opts, ctx.found_by_first, ctx.stats);
+    if (opts.perf) ReportPerf(N, D, ctx.perf_by_first);
+    return ctx.found;
+}
+
+template <int MaxN, int MaxD>
+struct InitParallel {
+    static void run(int N, int D, const Options &opts) {
+        typedef DepthProfile<MaxD> Profiled;
+        if (opts.profile != nullptr && opts.engine == Engine::Bitset) {
+            RunParallel<DcGenerator<MaxN, MaxD, BitsetDiffs, RuntimeDims, Profiled>>(N, D, opts);
+        } else if (opts.profile != nullptr) {
+            RunParallel<DcGenerator<MaxN, MaxD, CounterDiffs, RuntimeDims, Profiled>>(N, D, opts);
+        } else if (opts.engine == Engine::Bitset) {
+            RunParallel<DcGenerator<MaxN, MaxD, BitsetDiffs>>(N, D, opts);
+        } else if (opts.engine == Engine::Driven) {
+            RunParallel<DifferenceDriven<MaxN, MaxD>>(N, D, opts);
+        } else {
+            RunParallel<DcGenerator<MaxN, MaxD, CounterDiffs>>(N, D, opts);
+        }
+    }
+};
+
+// Spreading one enumeration over processes through a WorkDir.  The
+// coordinator writes one task per a[1] (the same root prefixes RunParallel
+// submits) and a job line with the settings; each worker runs one task at
+// a time on a pool of its own, with the usual donation between its threads,
+// and writes the covers followed by a summary line
+//
+//   # a[1] found nodes cuts[0..NUM_BOUNDS-1] non_leaders
+//
+// which the coordinator copies to stdout and folds in as results appear.
+
+// Prefixes as text: t p r1 hi lo a[1..t]
+static std::string FormatPrefix(const Prefix &prefix) {
+    std::string text = std::to_string(prefix.t) + " " + std::to_string(prefix.p) + " "
+                       + std::to_string(prefix.r1) + " " + std::to_string(prefix.hi) + " "
+                       + std::to_string(prefix.lo);
+    for (int idx = 0; idx < prefix.t; ++idx) text += " " + std::to_string(prefix.a[idx]);
+    return text + "\n";
+}
+
+// Reads a task of the run (N, D); false unless it is a ValidPrefix
+static bool ParsePrefix(const std::string &text, int N, int D, Prefix &prefix) {
+    const char *pos = text.c_str();
+    int len = 0;
+    if (sscanf(pos, "%d %d %d %d %d%n", &prefix.t, &prefix.p, &prefix.r1, &prefix.hi, &prefix.lo,
+               &len)
+            != 5) {
+        return false;
+    }
+    // grown as the values are read, so a corrupt t cannot size the vector
+    prefix.a.clear();
+    for (int idx = 0; idx < prefix.t; ++idx) {
+        pos += len;
+        int value;
+        if (sscanf(pos, "%d%n", &value, &len) != 1) return false;
+        prefix.a.push_back(value);
+    }
+    return ValidPrefix(prefix, N, D);
+}
+
+// Settings every worker must share: DCW1 N D engine orbits print bounds
+// split_depth lease tasks
+static std::string FormatJob(int N, int D, const Options &opts, int tasks) {
+    char text[128];
+    snprintf(text, sizeof(text), "DCW1 %d %d %d %d %d %u %d %d %d\n", N, D,
+             static_cast<int>(opts.engine), opts.orbits, opts.print, opts.bounds, opts.split_depth,
+             opts.lease, tasks);
+    return text;
+}
+
+static bool ParseJob(const std::string &text, int &N, int &D, Options &opts, int &tasks) {
+    int engine, orbits, print;
+    if (sscanf(text.c_str(), "DCW1 %d %d %d %d %d %u %d %d %d", &N, &D, &engine, &orbits, &print,
+               &opts.bounds, &opts.split_depth, &opts.lease, &tasks)
+        != 9) {
+        return false;
+    }
+    opts.engine = static_cast<Engine>(engine);
+    opts.orbits = orbits != 0;
+    opts.print = print != 0;
+    return N >= 3 && D >= 3 && N <= D * (D - 1) + 1 && opts.lease > 0;
+}
+
+// Seeds the work directory unless it already holds this job (a restarted
+// coordinator picks up where the last one stopped), then reissues expired
+// leases and merges results until every task is done
+static int Coordinate(int N, int D, const Options &opts) {
+    WorkDir dir(opts.coordinate);
+    const int start = (N + 1) / 2;
+    const int end = (N - 1) / D + 1;
+    const int tasks = start - end + 1;
+    const std::string job = FormatJob(N, D, opts, tasks);
+    std::string existing;
+    if (dir.get("job", existing)) {
+        if (existing != job) {
+            fprintf(stderr, "Error: %s holds another job\n", opts.coordinate);
+            return 1;
+        }
+    } else {
+        bool ok = dir.create();
+        for (int idx = start; ok && idx >= end; --idx) {
+            const Prefix prefix{1, 1, idx, std::vector<int>(1, idx), -1, 0};
+            ok = dir.put("todo/" + std::to_string(start - idx), FormatPrefix(prefix));
+        }
+        // the job goes last, so workers never see a partial task list
+        if (!ok || !dir.put("job", job)) {
+            fprintf(stderr, "Error: cannot write to %s\n", opts.coordinate);
+            return 1;
+        }
     }
-    int countdown = start - end;
-    for (auto &result : results) {
-        printf("%3d\r", countdown--);
+    if (opts.print) printf("Tasks: %d in %s\n", tasks, opts.coordinate);
+
+    std::vector<long long> found_by_first(N + 1, 0);
+    SearchStats stats;
+    std::vector<bool> merged(tasks, false);
+    int remaining = tasks;
+    while (remaining > 0) {
+        const int reissued = dir.reissue(opts.lease);
+        if (reissued > 0) fprintf(stderr, "reissued %d expired leases\n", reissued);
+        const std::vector<std::string> results = dir.list("results");
+        for (size_t idx = 0; idx < results.size(); ++idx) {
+            const int task = atoi(results[idx].c_str());
+            std::string body;
+            if (task < 0 || task >= tasks || merged[task]
+                || !dir.get("results/" + results[idx], body)) {
+                continue;
+            }
+            const size_t summary = body.rfind('#');
+            SearchStats task_stats;
+            int a1 = 0;
+            int len = 0;
+            const char *pos = summary == std::string::npos ? "" : body.c_str() + summary;
+            bool ok = sscanf(pos, "# %d %lld %lld%n", &a1, &task_stats.found, &task_stats.nodes,
+                             &len)
+                          == 3
+                      && a1 >= end && a1 <= start;
+            for (int bound = 0; ok && bound < NUM_BOUNDS; ++bound) {
+                pos += len;
+                ok = sscanf(pos, "%lld%n", &task_stats.cuts[bound], &len) == 1;
+            }
+            ok = ok && sscanf(pos + len, "%lld", &task_stats.non_leaders) == 1;
+            if (!ok) {
+                fprintf(stderr, "Error: malformed result %s\n", results[idx].c_str());
+                return 1;
+            }
+            fwrite(body.data(), 1, summary, stdout);
+            found_by_first[a1] += task_stats.found;
+            stats.add(task_stats);
+            merged[task] = true;
+            --remaining;
+        }
+        if (opts.print) printf("%3d\r", remaining);
         fflush(stdout);
-        result.get();
+        if (remaining > 0) sleep(1);
     }
-    printf("\n");
+    if (opts.print) printf("\n");
+    Report(N, D, opts, found_by_first, stats);
+    return 0;
+}
+
+// Claims and runs tasks until every task of the job has a result.  A
+// helper thread renews the current lease every third of the lease time.
+template <class Generator>
+void RunLeases(WorkDir &dir, int N, int D, const Options &opts, int tasks) {
+    ThreadPool pool;
+    const int split_depth = opts.split_depth >= 0 ? opts.split_depth : D - 4;
+    const int renew = opts.lease / 3 > 0 ? opts.lease / 3 : 1;
+    std::string task;
+    std::string body;
+    for (;;) {
+        if (!dir.claim(task, body)) {
+            if (static_cast<int>(dir.list("results").size()) >= tasks) return;
+            // the rest is leased; wait in case a lease expires
+            sleep(1);
+            continue;
+        }
+        Prefix prefix;
+        FILE *out = dir.open(task);
+        if (!ParsePrefix(body, N, D, prefix) || out == nullptr) {
+            fprintf(stderr, "Error: cannot run task %s\n", task.c_str());
+            exit(1);
+        }
+
+        std::mutex mutex;
+        std::condition_variable finished;
+        bool stop = false;
+        std::thread renewer([&]() {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (!finished.wait_for(lock, std::chrono::seconds(renew), [&]() { return stop; })) {
+                dir.renew(task);
+            }
+        });
+
+        SearchContext ctx(pool, opts, split_depth, N, D);
+        {
+            // the sink must be drained and gone before publish() closes out
+            CoverSink sink(out, CoverFormat::Text, N, D);
+            ctx.sink = &sink;
+            ctx.submit<Generator>(opts.print, prefix);
+            ctx.wait(false);
+            sink.flush();
+            ctx.sink = nullptr;
+        }
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            stop = true;
+        }
+        finished.notify_all();
+        renewer.join();
+
+        fprintf(out, "# %d %lld %lld", prefix.a[0], ctx.stats.found, ctx.stats.nodes);
+        for (int idx = 0; idx < NUM_BOUNDS; ++idx) fprintf(out, " %lld", ctx.stats.cuts[idx]);
+        fprintf(out, " %lld\n", ctx.stats.non_leaders);
+        if (!dir.publish(task, out)) {
+            fprintf(stderr, "Error: cannot publish task %s\n", task.c_str());
+        }
+    }
+}
+
+template <int MaxN, int MaxD>
+struct WorkLeases {
+    static void run(WorkDir &dir, int N, int D, const Options &opts, int tasks) {
+        if (opts.engine == Engine::Bitset) {
+            RunLeases<DcGenerator<MaxN, MaxD, BitsetDiffs>>(dir, N, D, opts, tasks);
+        } else if (opts.engine == Engine::Driven) {
+            RunLeases<DifferenceDriven<MaxN, MaxD>>(dir, N, D, opts, tasks);
+        } else {
+            RunLeases<DcGenerator<MaxN, MaxD, CounterDiffs>>(dir, N, D, opts, tasks);
+        }
+    }
+};
+
+static int Work(const char *path) {
+    WorkDir dir(path);
+    std::string job;
+    int N, D, tasks;
+    Options opts;
+    if (!dir.get("job", job) || !ParseJob(job, N, D, opts, tasks)) {
+        fprintf(stderr, "Error: no job in %s\n", path);
+        return 1;
+    }
+    if (!DispatchCapacity<WorkLeases>(N, D, dir, N, D, opts, tasks)) {
+        printf("Error: N <= %d and D <= %d required\n", CAPACITY_MAX_N, CAPACITY_MAX_D);
+        return 1;
+    }
+    printf("Finished successfully\n");
+    return 0;
+}
+
+// Kernels specialized on (N, D) for every row of diffcover.txt.  They are
+// only compiled with -DDC_SPECIALIZED, since instantiating all of them
+// takes a while; other (N, D) fall back to the generic engine.
+struct Kernel {
+    int N;
+    int D;
+    long long (*run)(const Options &opts);
+};
+
+#ifdef DC_SPECIALIZED
+template <int CN, int CD>
+long long RunFixed(const Options &opts) {
+    if (opts.engine == Engine::Bitset) {
+        return RunParallel<DcGenerator<CN, CD, BitsetDiffs, FixedDims<CN, CD>>>(CN, CD, opts);
+    }
+    return RunParallel<DcGenerator<CN, CD, CounterDiffs, FixedDims<CN, CD>>>(CN, CD, opts);
+}
+
+static const Kernel kernels[] = {
+#    define DC_KERNEL(n, d) {n, d, &RunFixed<n, d>},
+#    include "dc_kernels.inc"
+#    undef DC_KERNEL
+};
+
+const Kernel *FindKernel(int N, int D) {
+    for (const Kernel &kernel : kernels) {
+        if (kernel.N == N && kernel.D == D) return &kernel;
+    }
+    return nullptr;
+}
+#else
+const Kernel *FindKernel(int, int) { return nullptr; }
+#endif
+
+// Runs every engine without printing and reports wall time and the number of
+// covers found, which must agree between engines.
+template <class Run>
+void BenchEngine(const char *name, int N, int D, Run run) {
+    const auto start = std::chrono::steady_clock::now();
+    const long long total = run();
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    printf("%-13s N=%d D=%d found=%lld time=%.3fs\n", name, N, D, total, elapsed.count());
+}
+
+template <int MaxN, int MaxD>
+struct Bench {
+    static void run(int N, int D, const Options &opts) {
+        Options quiet = opts;
+        quiet.print = false;
+        quiet.count = false;
+        quiet.estimate = 0;
+        quiet.costs = nullptr;
+        quiet.output = nullptr;
+        printf("capacity class: MaxN=%d MaxD=%d simd: %s\n", MaxN, MaxD, SimdLevel());
+        BenchEngine("counter", N, D, [&]() {
+            return RunParallel<DcGenerator<MaxN, MaxD, CounterDiffs>>(N, D, quiet);
+        });
+        BenchEngine("bitset", N, D, [&]() {
+            return RunParallel<DcGenerator<MaxN, MaxD, BitsetDiffs>>(N, D, quiet);
+        });
+        BenchEngine("driven", N, D, [&]() {
+            return RunParallel<DifferenceDriven<MaxN, MaxD>>(N, D, quiet);
+        });
+
+        const Kernel *kernel = FindKernel(N, D);
+        if (kernel == nullptr) return;
+        quiet.engine = Engine::Counter;
+        BenchEngine("counter/fixed", N, D, [&]() { return kernel->run(quiet); });
+        quiet.engine = Engine::Bitset;
+        BenchEngine("bitset/fixed", N, D, [&]() { return kernel->run(quiet); });
+    }
+};
+
+// Bounds named in the comma-separated `list` (empty for none); false if a
+// name is unknown
+static bool ParseBounds(const char *list, unsigned &bounds) {
+    bounds = 0;
+    if (*list == '\0') return true;
+    for (const char *pos = list;; ++pos) {
+        const size_t len = strcspn(pos, ",");
+        int idx = 0;
+        while (idx < NUM_BOUNDS
+               && (strlen(bound_names[idx]) != len || strncmp(pos, bound_names[idx], len) != 0)) {
+            ++idx;
+        }
+        if (idx == NUM_BOUNDS) return false;
+        bounds |= 1u << idx;
+        pos += len;
+        if (*pos == '\0') return true;
+    }
+}
+
+static void usage() {
+    printf(
+        "Usage: necklace [n] [d] [--engine=counter|bitset|driven] [--generic] [--split-depth=k] "
+        "[--first] [--count] [--orbits] "
+        "[--bound=pairs,lookahead,divisors] [--stats] [--bench] "
+        "[--checkpoint=file [--checkpoint-interval=s] [--resume]] [--coordinate=dir [--lease=s]] "
+        "[--estimate=probes] [--estimate-only] [--profile=file.csv|file.json] [--perf] "
+        "[--lpt] [--costs=file] [--format=text|binary|ndjson|compact] [--output=file] "
+        "(n>=3, d>=3, n<=d*(d-1)+1)\n"
+        "       necklace --work=dir\n");
 }
 
 int main(int argc, const char *argv[]) {
-    if (argc != 3) {
-        DcGenerator::usage();
+    // a worker takes N, D and the settings from the job in the directory
+    if (argc == 2 && strncmp(argv[1], "--work=", 7) == 0) return Work(argv[1] + 7);
+    if (argc < 3) {
+        usage();
         return 1;
     }
 
     int N = atoi(argv[1]);
     int D = atoi(argv[2]);
 
-    if (N < 3 || D < 3 || N > D * (D - 1) + 1) {
-        DcGenerator::usage();
+    Options opts;
+    for (int idx = 3; idx < argc; ++idx) {
+        if (strcmp(argv[idx], "--engine=counter") == 0) {
+            opts.engine = Engine::Counter;
+        } else if (strcmp(argv[idx], "--engine=bitset") == 0) {
+            opts.engine = Engine::Bitset;
+        } else if (strcmp(argv[idx], "--engine=driven") == 0) {
+            opts.engine = Engine::Driven;
+        } else if (strcmp(argv[idx], "--bench") == 0) {
+            opts.bench = true;
+        } else if (strcmp(argv[idx], "--count") == 0) {
+            opts.count = true;
+            opts.print = false;
+        } else if (strcmp(argv[idx], "--stats") == 0) {
+            opts.stats = true;
+        } else if (strncmp(argv[idx], "--bound=", 8) == 0) {
+            if (!ParseBounds(argv[idx] + 8, opts.bounds)) {
+                usage();
+                return 1;
+            }
+        } else if (strcmp(argv[idx], "--orbits") == 0) {
+            opts.orbits = true;
+        } else if (strcmp(argv[idx], "--first") == 0) {
+            opts.first = true;
+        } else if (strcmp(argv[idx], "--generic") == 0) {
+            opts.generic = true;
+        } else if (strncmp(argv[idx], "--checkpoint=", 13) == 0) {
+            opts.checkpoint = argv[idx] + 13;
+        } else if (strncmp(argv[idx], "--checkpoint-interval=", 22) == 0) {
+            opts.checkpoint_interval = atoi(argv[idx] + 22);
+        } else if (strcmp(argv[idx], "--resume") == 0) {
+            opts.resume = true;
+        } else if (strncmp(argv[idx], "--coordinate=", 13) == 0) {
+            opts.coordinate = argv[idx] + 13;
+        } else if (strncmp(argv[idx], "--estimate=", 11) == 0) {
+            opts.estimate = atoi(argv[idx] + 11);
+        } else if (strcmp(argv[idx], "--perf") == 0) {
+            opts.perf = true;
+        } else if (strcmp(argv[idx], "--format=text") == 0) {
+            opts.format = CoverFormat::Text;
+        } else if (strcmp(argv[idx], "--format=binary") == 0) {
+            opts.format = CoverFormat::Binary;
+        } else if (strcmp(argv[idx], "--format=ndjson") == 0) {
+            opts.format = CoverFormat::Json;
+        } else if (strcmp(argv[idx], "--format=compact") == 0) {
+            opts.format = CoverFormat::Compact;
+        } else if (strncmp(argv[idx], "--output=", 9) == 0) {
+            opts.output = argv[idx] + 9;
+        } else if (strcmp(argv[idx], "--lpt") == 0) {
+            opts.lpt = true;
+        } else if (strncmp(argv[idx], "--costs=", 8) == 0) {
+            opts.costs = argv[idx] + 8;
+            opts.lpt = true;
+        } else if (strncmp(argv[idx], "--profile=", 10) == 0) {
+            opts.profile = argv[idx] + 10;
+        } else if (strcmp(argv[idx], "--estimate-only") == 0) {
+            opts.estimate_only = true;
+        } else if (strncmp(argv[idx], "--lease=", 8) == 0) {
+            opts.lease = atoi(argv[idx] + 8);
+        } else if (strncmp(argv[idx], "--split-depth=", 14) == 0) {
+            opts.split_depth = atoi(argv[idx] + 14);
+        } else {
+            usage();
+            return 1;
+        }
+    }
+
+    if (N < 3 || D < 3 || N > D * (D - 1) + 1 || opts.estimate < 0) {
+        usage();
+        return 1;
+    }
+    if (opts.estimate_only && opts.estimate == 0) opts.estimate = 1000;
+    // Checkpoints pause the bracelet search between slices of its explicit
+    // stack, and a resumed run appends, which a compact file's index forbids
+    if ((opts.resume || opts.checkpoint != nullptr)
+        && (opts.checkpoint == nullptr || opts.checkpoint_interval <= 0 || opts.bench
+            || opts.engine == Engine::Driven || opts.format == CoverFormat::Compact)) {
+        usage();
         return 1;
     }
 
-    InitParallel(N, D);
+    // Workers report whole tasks, so a coordinated run cannot stop early or checkpoint
+    if (opts.coordinate != nullptr) {
+        if (opts.first || opts.bench || opts.checkpoint != nullptr || opts.estimate > 0
+            || opts.profile != nullptr || opts.perf || opts.lpt || opts.output != nullptr
+            || opts.format != CoverFormat::Text || opts.lease < 3
+            || N > CAPACITY_MAX_N || D > CAPACITY_MAX_D) {
+            usage();
+            return 1;
+        }
+        return Coordinate(N, D, opts);
+    }
+
+    // Binary and NDJSON covers need a file of their own, apart from the messages
+    if (opts.format != CoverFormat::Text && opts.output == nullptr) {
+        usage();
+        return 1;
+    }
+
+    // Profiles come from instrumented bracelet searches on the runtime dimensions
+    if (opts.profile != nullptr && (opts.bench || opts.engine == Engine::Driven)) {
+        usage();
+        return 1;
+    }
+
+    // The fixed kernels are bracelet searches
+    const bool generic = opts.generic || opts.engine == Engine::Driven || opts.profile != nullptr;
+    const Kernel *kernel = generic ? nullptr : FindKernel(N, D);
+    if (kernel != nullptr && !opts.bench) {
+        kernel->run(opts);
+        printf("Finished successfully\n");
+        return 0;
+    }
+
+    // The generator keeps a[0..D] and positions 0..N-1 in fixed-size arrays
+    const bool fits = opts.bench ? DispatchCapacity<Bench>(N, D, N, D, opts)
+                                 : DispatchCapacity<InitParallel>(N, D, N, D, opts);
+    if (!fits) {
+        printf("Error: N <= %d and D <= %d required\n", CAPACITY_MAX_N, CAPACITY_MAX_D);
+        return 1;
+    }
+    if (opts.bench) return 0;
+    if (opts.profile != nullptr && !ProfileLog::global().dump(opts.profile)) {
+        fprintf(stderr, "Error: cannot write profile %s\n", opts.profile);
+        return 1;
+    }
     printf("Finished successfully\n");
     return 0;
 }
@@ -59,19 +59,20 @@ speed things up, and systematically exploring all possibilities.
 #include <future>  // for future
 #include <vector>
 
+#include "Capacity.h"
+#include "CoverSink.h"
+#include "Profile.h"
 #include "ThreadPool.h"
 
-const auto MAX = 20;
-const auto MAX_N = 80;
-
 //-------------------------------------------------------------
 // GLOBAL VARIABLES
 //-------------------------------------------------------------
-struct DiffCover {
+template <int MaxN, int MaxD, class Profile = NoProfile>
+struct DiffCover : private Profile {
     int num_elem;
     int density;
-    int a[MAX];
-    int b[MAX];
+    int a[MaxD + 1];
+    int b[MaxD + 1];
     int threshold;
     int d_minus_1;
     int d_times_d_minus_1;
@@ -80,6 +81,7 @@ struct DiffCover {
     int n2;
     // const int *begin_a;
     size_t size_n;
+    CoverSink::Buffer covers;
 
     /**
      * Constructs a DiffCover object with the given parameters.
@@ -88,8 +90,9 @@ struct DiffCover {
      * @param density The number of elements in the D-set.
      * @param threshold The threshold for the number of differences between
      * elements.
+     * @param sink Where the D-sets go, straight to stdout if null.
      */
-    DiffCover(int num_elem, int density, int threshold)
+    DiffCover(int num_elem, int density, int threshold, CoverSink *sink = nullptr)
         : num_elem{num_elem},
           density{density},
           threshold{threshold},
@@ -98,7 +101,8 @@ struct DiffCover {
           n_minus_d{num_elem - density},
           n1{num_elem / 2 - density * (density - 1) / 2},
           n2{num_elem / 2},  // begin_a{&a[0]},
-          size_n{(num_elem / 2 + 1) * sizeof(int8_t)} {
+          size_n{(num_elem / 2 + 1) * sizeof(int8_t)},
+          covers(sink) {
         for (auto idx = 0; idx <= density; idx++) a[idx] = 0;
 
         a[density] = num_elem;
@@ -107,18 +111,9 @@ struct DiffCover {
 
     //-------------------------------------------------------------
     /**
-     * Prints the generated D-set to stdout.
+     * Adds the generated D-set to this search's buffer of the output.
      */
-    void PrintD() const {
-        // print a
-        printf("\n");
-        for (auto idx = 1; idx <= this->density; idx++) {
-            printf("%d ", this->a[idx]);
-        }
-        printf("\n");
-        fflush(stdout);
-        return;
-    }
+    void PrintD() { covers.put(&this->a[1], this->density); }
 
     /**
      * GenD Function
@@ -184,7 +179,8 @@ struct DiffCover {
      * @param diffset[] - Bit array tracking differences between elements
      */
     void GenD(int t, int p, int8_t diffset[]) {
-        int8_t differences[MAX_N];
+        Profile::enter(t);
+        int8_t differences[MaxN / 2 + 1];
         memcpy(differences, diffset, this->size_n);
 
         const auto at = this->a[t];
@@ -194,19 +190,22 @@ struct DiffCover {
             differences[pos_diff <= neg_diff ? pos_diff : neg_diff] = 1;
         }
         if (t >= this->threshold) {
-            int8_t count = 0;
+            int count = 0;
             const int8_t *begin = &differences[1];
             for (auto ptr = begin; ptr != begin + this->n2; ++ptr) {
                 count += *ptr;
             }
-            if (int(count) < this->n1 + t * (t + 1) / 2) {
+            if (count < this->n1 + t * (t + 1) / 2) {
+                Profile::prune(t);
                 return;
             }
         }
 
         const auto t1 = t + 1;
-        if (t1 >= this->density)
+        if (t1 >= this->density) {
+            Profile::leaf(t1);
             this->PrintD();
+        }
         else {
             auto tail = this->n_minus_d + t1;
             const auto max = this->a[t1 - p] + this->a[p];
@@ -229,12 +228,70 @@ struct DiffCover {
             }
         }
     }
+
+    /**
+     * Hands the profile of the finished search of a[1] to the ProfileLog and
+     * its D-sets to the output.
+     */
+    void Finish() {
+        Profile::finish(&this->a[1], 1);
+        covers.flush();
+    }
 };
 
 //------------------------------------------------------
-void usage() { printf("Usage: necklace [num_elem] [density] [threshold]\n"); }
+void usage() { printf("Usage: necklace [num_elem] [density] [threshold] [--profile=file]\n"); }
 //--------------------------------------------------------------------------------
 
+/**
+ * Runs one DiffCover search per first element on a thread pool, with all
+ * arrays sized by the capacity class chosen in main().  Profile selects the
+ * per-depth counters (see Profile.h).
+ */
+template <int MaxN, int MaxD>
+struct RunPool {
+    static void run(int num_elem, int density, int threshold, const char *profile) {
+        if (profile != nullptr) {
+            search<DepthProfile<MaxD>>(num_elem, density, threshold);
+        } else {
+            search<NoProfile>(num_elem, density, threshold);
+        }
+    }
+
+    template <class Profile>
+    static void search(int num_elem, int density, int threshold) {
+        ThreadPool pool;
+        printf("Number of workers: %zu\n", pool.size());
+        // the D-sets as always printed, "%d " each, written by one thread
+        CoverSink sink(stdout, CoverFormat::Text, num_elem, density, 0);
+        std::vector<std::future<void>> results;
+        auto start = (num_elem + 1) / 2;
+        auto end = (num_elem - 1) / density + 1;
+
+        // for (auto j = num_elem - density + 1; j >= end; j--) {
+        for (auto idx = start; idx >= end; idx--) {
+            results.emplace_back(pool.enqueue([num_elem, density, threshold, idx, &sink]() {
+                DiffCover<MaxN, MaxD, Profile> dc(num_elem, density, threshold, &sink);
+                dc.a[1] = idx;
+                dc.b[1] = 1;
+                int8_t differences[MaxN / 2 + 1];
+                memset(differences, 0, dc.size_n);
+                differences[0] = 1;
+                dc.GenD(1, 1, differences);
+                dc.Finish();
+            }));
+        }
+        auto countdown = start - end;
+        for (auto &&result : results) {
+            printf("%3d\r", countdown--);
+            fflush(stdout);
+            result.get();
+        }
+        sink.flush();
+        printf("\n");
+    }
+};
+
 /**
  * Main Function in mdiffset.cpp
  *
@@ -306,31 +363,22 @@ int main(int argc, char **argv) {
     // printf("%3d\n", end);
     // diff_cover.run();
 
-    auto num_workers = std::thread::hardware_concurrency() * 3 / 4;
-    ThreadPool pool(num_workers);
-    printf("Number of workers: %d\n", num_workers);
-    std::vector<std::future<void>> results;
-    auto start = (num_elem + 1) / 2;
-    auto end = (num_elem - 1) / density + 1;
+    const char *profile = nullptr;
+    if (argc > 4) {
+        if (strncmp(argv[4], "--profile=", 10) != 0) {
+            usage();
+            return 1;
+        }
+        profile = argv[4] + 10;
+    }
 
-    // for (auto j = num_elem - density + 1; j >= end; j--) {
-    for (auto idx = start; idx >= end; idx--) {
-        results.emplace_back(pool.enqueue([&num_elem, &density, &threshold, idx]() {
-            DiffCover dc(num_elem, density, threshold);
-            dc.a[1] = idx;
-            dc.b[1] = 1;
-            int8_t differences[MAX_N];
-            memset(differences, 0, dc.size_n);
-            differences[0] = 1;
-            dc.GenD(1, 1, differences);
-        }));
+    if (!DispatchCapacity<RunPool>(num_elem, density, num_elem, density, threshold, profile)) {
+        printf("Error: N <= %d and D <= %d required\n", CAPACITY_MAX_N, CAPACITY_MAX_D);
+        return 1;
     }
-    auto countdown = start - end;
-    for (auto &&result : results) {
-        printf("%3d\r", countdown--);
-        fflush(stdout);
-        result.get();
+    if (profile != nullptr && !ProfileLog::global().dump(profile)) {
+        printf("Error: cannot write profile %s\n", profile);
+        return 1;
     }
-    printf("\n");
     return 0;
 }